@@ -14,6 +14,114 @@ def readFileBin(path):
     with open(path, 'rb') as f:
         return f.read()
 
+def decodeBmp(data):
+    # returns (width, height, [(r, g, b, a), ...]) top to bottom
+    # supports uncompressed 8/24/32 bit and 32 bit BI_BITFIELDS
+    pixelOffset, = struct.unpack_from('<I', data, 10)
+    headerSize, width, height, planes, bpp, compression = \
+        struct.unpack_from('<IiiHHI', data, 14)
+    flip = height > 0
+    height = abs(height)
+    masks = None
+    if compression == 3:
+        masks = struct.unpack_from('<IIII' if headerSize >= 56 else '<III', data, 14 + 40)
+    elif compression != 0:
+        raise ValueError(f"unsupported bmp compression {compression}")
+    palette = []
+    if bpp == 8:
+        colors, = struct.unpack_from('<I', data, 14 + 32)
+        colors = colors or 256
+        for i in range(colors):
+            b, g, r, _ = struct.unpack_from('<BBBB', data, 14 + headerSize + 4 * i)
+            palette.append((r, g, b, 255))
+
+    def channel(value, mask):
+        if mask == 0:
+            return 255
+        shift = (mask & -mask).bit_length() - 1
+        return ((value & mask) >> shift) * 255 // (mask >> shift)
+
+    stride = (width * bpp + 31) // 32 * 4
+    pixels = []
+    for y in range(height):
+        row = pixelOffset + stride * ((height - 1 - y) if flip else y)
+        for x in range(width):
+            if bpp == 8:
+                pixels.append(palette[data[row + x]])
+            elif bpp == 24:
+                b, g, r = data[row + 3 * x:row + 3 * x + 3]
+                pixels.append((r, g, b, 255))
+            elif bpp == 32:
+                value, = struct.unpack_from('<I', data, row + 4 * x)
+                if masks:
+                    a = channel(value, masks[3]) if len(masks) == 4 else 255
+                    pixels.append((channel(value, masks[0]), channel(value, masks[1]),
+                                   channel(value, masks[2]), a))
+                else:
+                    pixels.append(((value >> 16) & 255, (value >> 8) & 255, value & 255, 255))
+            else:
+                raise ValueError(f"unsupported bmp depth {bpp}")
+    return width, height, pixels
+
+def bmpToRgba(data):
+    # pre-keyed RGBA8888 blob: 'TEX0' header then packed 0xRRGGBBAA pixels,
+    # with black made transparent to match the loader's colour key
+    width, height, pixels = decodeBmp(data)
+    out = bytearray(struct.pack('<4sii4x', b'TEX0', width, height))
+    for r, g, b, a in pixels:
+        if r == 0 and g == 0 and b == 0:
+            a = 0
+        out += struct.pack('<I', (r << 24) | (g << 16) | (b << 8) | a)
+    return bytes(out)
+
+LZ_MIN_MATCH = 4
+LZ_MAX_OFFSET = 65535
+LZ_HASH_BITS = 14
+
+def lzWriteLength(out, length):
+    while length >= 255:
+        out.append(255)
+        length -= 255
+    out.append(length)
+
+def lzCompress(src):
+    # LZ4-style block, must match Lz_decompress in src/lz.c
+    n = len(src)
+    table = {}
+    out = bytearray()
+    anchor = 0
+    i = 0
+    matchLimit = n - 12
+    while i < matchLimit:
+        key = src[i:i + 4]
+        candidate = table.get(key, -1)
+        table[key] = i
+        if candidate < 0 or i - candidate > LZ_MAX_OFFSET:
+            i += 1
+            continue
+        length = LZ_MIN_MATCH
+        while i + length < n - 5 and src[candidate + length] == src[i + length]:
+            length += 1
+        literals = i - anchor
+        matchCode = length - LZ_MIN_MATCH
+        out.append((min(literals, 15) << 4) | min(matchCode, 15))
+        if literals >= 15:
+            lzWriteLength(out, literals - 15)
+        out += src[anchor:i]
+        out += struct.pack('<H', i - candidate)
+        if matchCode >= 15:
+            lzWriteLength(out, matchCode - 15)
+        i += length
+        anchor = i
+    literals = n - anchor
+    out.append(min(literals, 15) << 4)
+    if literals >= 15:
+        lzWriteLength(out, literals - 15)
+    out += src[anchor:]
+    return bytes(out)
+
+ARC_FLAG_LZ = 1
+
 class ArcBuilder:
     def __init__(self):
         self.entries = []
@@ -23,7 +131,10 @@ class ArcBuilder:
         self.entries.append({ "name": name, "content": content })
         print(f"added {name} ({len(content)} bytes)")
 
-    def write(self, outpath):
+    def write(self, outpath, compress=False):
+        if compress:
+            self.writeCompressed(outpath)
+            return
         offset = 16 + 32 * len(self.entries)
         for entry in self.entries:
             entry["offset"] = offset
@@ -36,6 +147,30 @@ class ArcBuilder:
                 f.seek(entry["offset"])
                 f.write(entry["content"])
 
+    def writeCompressed(self, outpath):
+        # ARC1: entries also carry the uncompressed size and flags
+        for entry in self.entries:
+            raw = entry["content"]
+            entry["rawSize"] = len(raw)
+            entry["flags"] = 0
+            packed = lzCompress(raw)
+            if len(packed) < len(raw):
+                entry["content"] = packed
+                entry["flags"] |= ARC_FLAG_LZ
+            print(f"packed {entry['name']} ({len(raw)} -> {len(entry['content'])} bytes)")
+        offset = 16 + 40 * len(self.entries)
+        for entry in self.entries:
+            entry["offset"] = offset
+            offset += align16(len(entry["content"]))
+        with open(outpath, 'wb') as f:
+            f.write(struct.pack('<4sii4x', b'ARC1', 300, len(self.entries)))
+            for entry in self.entries:
+                f.write(struct.pack('<iiii24s', entry["offset"], len(entry["content"]),
+                                    entry["rawSize"], entry["flags"], entry["name"].encode()))
+            for entry in self.entries:
+                f.seek(entry["offset"])
+                f.write(entry["content"])
+
 def makeArcFromFiles(outfile, infiles):
     # ftable = []
     # offset = align16(4 + (64+8) * len(infiles))
@@ -74,8 +209,17 @@ def makeArcFromFiles(outfile, infiles):
             f.write(entry[2])
 
 if __name__ == "__main__":
-    if len(sys.argv) == 1:
-        print("usage: arctool.py <outfile.arc> [infiles...]")
+    args = sys.argv[1:]
+    rgba = '--rgba' in args
+    if rgba:
+        args.remove('--rgba')
+    compress = '--compress' in args
+    if compress:
+        args.remove('--compress')
+    if len(args) == 0:
+        print("usage: arctool.py [--rgba] [--compress] <outfile.arc> [infiles...]")
+        print("  --rgba      store .bmp files as pre-keyed RGBA8888 blobs")
+        print("  --compress  write an ARC1 archive with LZ compressed entries")
     else:
         # def bunpath(f):
         #     return os.path.join(sys.argv[1], f)
@@ -89,9 +233,12 @@ if __name__ == "__main__":
         #     arc.addFile('M'+k, readFileText(bunpath(v)).encode())
         # arc.write(sys.argv[1] + '.bun')
         arc = ArcBuilder()
-        for path in sys.argv[2:]:
+        for path in args[1:]:
             try:
-                arc.addFile(path, readFileBin(path))
+                data = readFileBin(path)
+                if rgba and path.lower().endswith('.bmp'):
+                    data = bmpToRgba(data)
+                arc.addFile(path, data)
             except Exception as e:
                 print(e)
-        arc.write(sys.argv[1])
+        arc.write(args[0], compress)
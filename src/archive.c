@@ -4,67 +4,362 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define ARCHIVE_NAME_LENGTH 24
+#define MAX_SHARED_ARCHIVES 8
+#define MAX_ARCHIVE_WORKERS 8
+#define ARCHIVE_FLAG_LZ 1
+
+// on-disk entry, ARC0
+struct archive_entry0 {
+    int offset;
+    int size;
+    char name[ARCHIVE_NAME_LENGTH];
+};
+
+// on-disk entry, ARC1 adds per-entry compression
+struct archive_entry1 {
+    int offset;
+    int size; // stored size
+    int raw_size;
+    int flags;
+    char name[ARCHIVE_NAME_LENGTH];
+};
+
 struct archive_entry {
     int offset;
     int size;
-    char name[24];
+    int raw_size;
+    int flags;
+    char name[ARCHIVE_NAME_LENGTH];
+    SDL_atomic_t state; // 0: packed, 1: unpacking, 2: ready
+    uint8_t* raw; // decompressed data, for compressed entries
+};
+
+struct archive_header {
+    char magic[4];
+    int version;
+    int n_entries;
+    int pad;
 };
 
 struct archive {
-    FILE* f;
+    const uint8_t* data; // whole file, mapped read-only
+    size_t size;
     int n_entries;
     struct archive_entry* entries;
+    int n_slots; // power of two
+    int* slots; // open addressing name hash -> entry index, -1 if empty
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+    // background decompression
+    SDL_Thread* workers[MAX_ARCHIVE_WORKERS];
+    int n_workers;
+    SDL_atomic_t next_job;
 };
 
+static struct {
+    char path[MAX_ASSETPATH_LENGTH];
+    Archive archive;
+} _shared[MAX_SHARED_ARCHIVES];
+static int _sharedCount;
+
+// bytes of entry data made ready, across all archives
+static SDL_atomic_t _bytesDone;
+static SDL_atomic_t _bytesTotal;
+
+static uint32_t _hashName(const char* name) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < ARCHIVE_NAME_LENGTH && name[i]; i++) {
+        hash = (hash ^ (uint8_t) name[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static bool _map(Archive self, const char* path) {
+#ifdef _WIN32
+    self->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (self->file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    GetFileSizeEx(self->file, &size);
+    self->size = (size_t) size.QuadPart;
+    self->mapping = CreateFileMappingA(self->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!self->mapping) {
+        CloseHandle(self->file);
+        return false;
+    }
+    self->data = MapViewOfFile(self->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!self->data) {
+        CloseHandle(self->mapping);
+        CloseHandle(self->file);
+        return false;
+    }
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    self->size = st.st_size;
+    void* data = mmap(NULL, self->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+    self->data = data;
+#endif
+    return true;
+}
+
+static void _unmap(Archive self) {
+#ifdef _WIN32
+    UnmapViewOfFile(self->data);
+    CloseHandle(self->mapping);
+    CloseHandle(self->file);
+#else
+    munmap((void*) self->data, self->size);
+#endif
+}
+
+static struct archive_entry* _findEntry(Archive self, const char* name) {
+    uint32_t slot = _hashName(name) & (self->n_slots - 1);
+    while (self->slots[slot] != -1) {
+        struct archive_entry* entry = &self->entries[self->slots[slot]];
+        if (strncmp(entry->name, name, ARCHIVE_NAME_LENGTH) == 0) return entry;
+        slot = (slot + 1) & (self->n_slots - 1);
+    }
+    return NULL;
+}
+
 Archive Archive_open(const char* path) {
-    Archive self = malloc(sizeof(struct archive));
-    self->f = fopen(path, "rb");
-    if (!self->f) return NULL;
-    struct {
-        char magic[4];
-        int version;
-        int n_entries;
-        int pad;
-    } hdr;
-    fread(&hdr, sizeof(hdr), 1, self->f);
-    self->n_entries = hdr.n_entries;
-    self->entries = malloc(sizeof(struct archive_entry) * self->n_entries);
-    fread(self->entries, sizeof(struct archive_entry), self->n_entries, self->f);
+    Archive self = calloc(1, sizeof(struct archive));
+    if (!_map(self, path)) {
+        free(self);
+        return NULL;
+    }
+
+    const struct archive_header* hdr = (const void*) self->data;
+    int version = -1;
+    size_t entrySize = 0;
+    if (self->size >= sizeof(*hdr) && memcmp(hdr->magic, "ARC0", 4) == 0) {
+        version = 0;
+        entrySize = sizeof(struct archive_entry0);
+    } else if (self->size >= sizeof(*hdr) && memcmp(hdr->magic, "ARC1", 4) == 0) {
+        version = 1;
+        entrySize = sizeof(struct archive_entry1);
+    }
+    if (version == -1 || hdr->n_entries < 0 ||
+            sizeof(*hdr) + entrySize * hdr->n_entries > self->size) {
+        Log_error("bad archive header: '%s'", path);
+        _unmap(self);
+        free(self);
+        return NULL;
+    }
+    self->n_entries = hdr->n_entries;
+    self->entries = calloc(self->n_entries, sizeof(struct archive_entry));
+    const uint8_t* table = self->data + sizeof(*hdr);
+    for (int i = 0; i < self->n_entries; i++) {
+        struct archive_entry* entry = &self->entries[i];
+        if (version == 0) {
+            const struct archive_entry0* e = (const void*) (table + entrySize * i);
+            entry->offset = e->offset;
+            entry->size = e->size;
+            entry->raw_size = e->size;
+            memcpy(entry->name, e->name, ARCHIVE_NAME_LENGTH);
+        } else {
+            const struct archive_entry1* e = (const void*) (table + entrySize * i);
+            entry->offset = e->offset;
+            entry->size = e->size;
+            entry->raw_size = e->raw_size;
+            entry->flags = e->flags;
+            memcpy(entry->name, e->name, ARCHIVE_NAME_LENGTH);
+        }
+        SDL_AtomicSet(&entry->state, entry->flags & ARCHIVE_FLAG_LZ ? 0 : 2);
+    }
+
+    // build name index
+    self->n_slots = 16;
+    while (self->n_slots < self->n_entries * 2) self->n_slots *= 2;
+    self->slots = malloc(sizeof(int) * self->n_slots);
+    memset(self->slots, -1, sizeof(int) * self->n_slots);
+    for (int i = 0; i < self->n_entries; i++) {
+        struct archive_entry* entry = &self->entries[i];
+        if (entry->offset < 0 || entry->size < 0 || entry->raw_size < 0 ||
+                (size_t) entry->offset + entry->size > self->size) {
+            Log_warn("archive entry out of bounds: '%.24s'", entry->name);
+            entry->flags = 0;
+            SDL_AtomicSet(&entry->state, 2);
+            continue;
+        }
+        uint32_t slot = _hashName(entry->name) & (self->n_slots - 1);
+        while (self->slots[slot] != -1) slot = (slot + 1) & (self->n_slots - 1);
+        self->slots[slot] = i;
+    }
     return self;
 }
 
 void Archive_close(Archive self) {
-    fclose(self->f);
+    // stop workers picking up new entries, then wait for them
+    SDL_AtomicSet(&self->next_job, self->n_entries);
+    for (int i = 0; i < self->n_workers; i++) {
+        SDL_WaitThread(self->workers[i], NULL);
+    }
+    for (int i = 0; i < self->n_entries; i++) {
+        free(self->entries[i].raw);
+    }
+    _unmap(self);
     free(self->entries);
+    free(self->slots);
     free(self);
 }
 
-char* archive_read_text(Archive self, const char* name) {
-    for (int i = 0; i < self->n_entries; i++) {
-        if (strncmp(self->entries[i].name, name, 24) != 0) continue;
-        char* buf = malloc(self->entries[i].size + 1);
-        fseek(self->f, self->entries[i].offset, SEEK_SET);
-        fread(buf, self->entries[i].size, 1, self->f);
-        buf[self->entries[i].size] = 0;
-        return buf;
+// Decompress an entry if needed, waiting if another thread has it. NULL if
+// it's corrupt, which is logged once.
+static const uint8_t* _unpackEntry(Archive self, struct archive_entry* entry) {
+    if (!(entry->flags & ARCHIVE_FLAG_LZ)) return self->data + entry->offset;
+
+    if (SDL_AtomicCAS(&entry->state, 0, 1)) {
+        Trace_begin("unpackEntry");
+        uint8_t* raw = malloc(entry->raw_size ? entry->raw_size : 1);
+        int size = Lz_decompress(self->data + entry->offset, entry->size,
+                raw, entry->raw_size);
+        if (size != entry->raw_size) {
+            Log_error("corrupt archive entry: '%.24s'", entry->name);
+            free(raw);
+            raw = NULL;
+        }
+        entry->raw = raw;
+        SDL_AtomicAdd(&_bytesDone, entry->raw_size);
+        SDL_MemoryBarrierRelease();
+        SDL_AtomicSet(&entry->state, 2);
+        Trace_end();
+    } else {
+        while (SDL_AtomicGet(&entry->state) != 2) SDL_Delay(0);
+        SDL_MemoryBarrierAcquire();
     }
-    return NULL; // todo: assert
+    return entry->raw;
 }
 
-size_t Archive_getSize(Archive self, const char* name) {
-    for (int i = 0; i < self->n_entries; i++) {
-        if (strncmp(self->entries[i].name, name, 24) != 0) continue;
-        return self->entries[i].size;
+static int _worker(void* data) {
+    Archive self = data;
+    Trace_setThreadName("archive");
+    int i;
+    while ((i = SDL_AtomicAdd(&self->next_job, 1)) < self->n_entries) {
+        struct archive_entry* entry = &self->entries[i];
+        if (entry->flags & ARCHIVE_FLAG_LZ) _unpackEntry(self, entry);
     }
     return 0;
 }
 
-size_t Archive_read(Archive self, const char* name, size_t size, void* dst) {
+// Start decompressing all compressed entries on a pool of worker threads
+void Archive_unpackAsync(Archive self) {
+    if (self->n_workers > 0) return;
+
+    int packedBytes = 0;
     for (int i = 0; i < self->n_entries; i++) {
-        if (strncmp(self->entries[i].name, name, 24) != 0) continue;
-        fseek(self->f, self->entries[i].offset, SEEK_SET);
-        return fread(dst, self->entries[i].size, 1, self->f);
+        if (self->entries[i].flags & ARCHIVE_FLAG_LZ) {
+            packedBytes += self->entries[i].raw_size;
+        }
     }
-    Log_warn("file not found in archive: '%s'", name);
-    return 0;
+    if (packedBytes == 0) return;
+    SDL_AtomicAdd(&_bytesTotal, packedBytes);
+
+    int count = SDL_GetCPUCount() - 1;
+    if (count < 1) count = 1;
+    if (count > MAX_ARCHIVE_WORKERS) count = MAX_ARCHIVE_WORKERS;
+    for (int i = 0; i < count; i++) {
+        SDL_Thread* thread = SDL_CreateThread(_worker, "archive", self);
+        if (!thread) break;
+        self->workers[self->n_workers++] = thread;
+    }
+}
+
+// Bytes decompressed so far and total queued, across all archives
+void Archive_getProgress(int* done, int* total) {
+    if (done) *done = SDL_AtomicGet(&_bytesDone);
+    if (total) *total = SDL_AtomicGet(&_bytesTotal);
+}
+
+// Get an archive that stays open for the rest of the run, opening it on
+// first use
+Archive Archive_get(const char* path) {
+    for (int i = 0; i < _sharedCount; i++) {
+        if (strcmp(_shared[i].path, path) == 0) return _shared[i].archive;
+    }
+    if (_sharedCount == MAX_SHARED_ARCHIVES) {
+        Log_error("Max shared archives exceeded");
+        return NULL;
+    }
+    Archive self = Archive_open(path);
+    if (!self) return NULL;
+    strncpy(_shared[_sharedCount].path, path, MAX_ASSETPATH_LENGTH - 1);
+    _shared[_sharedCount].archive = self;
+    _sharedCount++;
+    return self;
+}
+
+void Archive_closeAll(void) {
+    for (int i = 0; i < _sharedCount; i++) {
+        Archive_close(_shared[i].archive);
+    }
+    _sharedCount = 0;
+}
+
+// Zero-copy view of an entry, valid until the archive is closed. NULL if
+// it's missing or corrupt.
+const void* Archive_view(Archive self, const char* name, size_t* size) {
+    struct archive_entry* entry = _findEntry(self, name);
+    if (!entry) {
+        Log_warn("file not found in archive: '%s'", name);
+        if (size) *size = 0;
+        return NULL;
+    }
+    const void* data = _unpackEntry(self, entry);
+    if (size) *size = data ? entry->raw_size : 0;
+    return data;
+}
+
+int Archive_getEntryCount(Archive self) {
+    return self->n_entries;
+}
+
+// View by position in the archive, for going through every entry
+const void* Archive_viewEntry(Archive self, int index, size_t* size) {
+    if (index < 0 || index >= self->n_entries) {
+        if (size) *size = 0;
+        return NULL;
+    }
+    struct archive_entry* entry = &self->entries[index];
+    const void* data = _unpackEntry(self, entry);
+    if (size) *size = data ? entry->raw_size : 0;
+    return data;
+}
+
+size_t Archive_getSize(Archive self, const char* name) {
+    struct archive_entry* entry = _findEntry(self, name);
+    return entry ? entry->raw_size : 0;
+}
+
+size_t Archive_read(Archive self, const char* name, size_t size, void* dst) {
+    struct archive_entry* entry = _findEntry(self, name);
+    if (!entry) {
+        Log_warn("file not found in archive: '%s'", name);
+        return 0;
+    }
+    const uint8_t* data = _unpackEntry(self, entry);
+    if (!data) return 0;
+    if (size > (size_t) entry->raw_size) size = entry->raw_size;
+    memcpy(dst, data, size);
+    return 1;
 }
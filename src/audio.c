@@ -1,33 +1,69 @@
 #include "common.h"
 #include <SDL_mixer.h>
 
+// Music streams and sound effects. Sounds play on a fixed set of voices.
+// Each sound has a priority and a limit on how many copies of it play at
+// once. When no voice is free, a new sound takes over the oldest one with
+// the lowest priority that isn't above its own. Copies of a sound started
+// in the same tick become one voice that is a little louder.
+
 // ===== [[ Defines ]] =====
 
 #define SOURCE_LENGTH 256
 #define MAX_MUSIC 64
 #define MAX_SOUNDS 64
+#define MAX_VOICES 16
+// voices start below full volume so merged copies can be louder
+#define VOICE_VOLUME (MIX_MAX_VOLUME * 3 / 4)
+#define MERGE_GAIN (MIX_MAX_VOLUME / 16)
 
 // ===== [[ Local Types ]] =====
 
 typedef struct {
     char name[NAME_LENGTH];
+    char source[MAX_ASSETPATH_LENGTH];
     Mix_Music* mixMusic;
 } Music;
 
 typedef struct {
     char name[NAME_LENGTH];
+    char source[MAX_ASSETPATH_LENGTH];
     Mix_Chunk* mixChunk;
+    int priority; // higher takes voices from lower
+    int maxVoices; // copies playing at once
 } Sound;
 
+typedef struct {
+    SoundID sound;
+    int priority;
+    Uint32 started; // tick
+    int volume;
+} Voice;
+
 // ===== [[ Declarations ]] =====
 
+static void _openMusic(Music* music);
+static void _restoreMusic(void);
+static void _restoreSounds(void);
+static Mix_Chunk* _decodeSound(const char* source);
+static int _findVoice(SoundID self);
+
 // ===== [[ Static Data ]] =====
 
 static Music _music[MAX_MUSIC];
 static Sound _sounds[MAX_SOUNDS];
 
 static int _musicCount;
+static NameIndex _musicIndex = NAME_INDEX(_music, _musicCount);
 static int _soundCount;
+static NameIndex _soundIndex = NAME_INDEX(_sounds, _soundCount);
+
+// decoded by prefetches, waiting for Sound_loadChunk
+static Mix_Chunk* _decodedChunks[MAX_SOUNDS];
+
+static Voice _voices[MAX_VOICES];
+static bool _opened;
+static Uint32 _tick;
 
 // ===== [[ Implementations ]] =====
 
@@ -40,10 +76,28 @@ void Audio_startup() {
         Log_error("failed to init audio: %s", Mix_GetError());
         return;
     }
-    if (Mix_AllocateChannels(16) < 0) {
+    if (Mix_AllocateChannels(MAX_VOICES) < 0) {
         Log_error("failed to init audio: %s", Mix_GetError());
         return;
     }
+    _opened = true;
+}
+
+void Audio_registerTables(void) {
+    GameDb_addTable("music", _music, sizeof(Music),
+            &_musicCount, MAX_MUSIC, _restoreMusic);
+    GameDb_addTable("sounds", _sounds, sizeof(Sound),
+            &_soundCount, MAX_SOUNDS, _restoreSounds);
+}
+
+void Audio_update(void) {
+    _tick++;
+#ifdef HELMSGARD_PROFILE
+    if (!_opened) return;
+    for (int i = 0; i < MAX_VOICES; i++) {
+        if (Mix_Playing(i)) PROFILE_COUNT(audioVoices, 1);
+    }
+#endif
 }
 
 void Music_loadFrom(const char* assetpath) {
@@ -61,18 +115,16 @@ void Music_loadFrom(const char* assetpath) {
         Music* music = &_music[_musicCount++];
         strncpy(music->name, name, NAME_LENGTH);
         
-        const char* source = Ini_get(name, "source");
+        int sourceLength;
+        const char* source = Ini_getSlice(name, "source", &sourceLength);
         if (!source) {
             Log_warn("Missing source for %s", name);
             continue;
         }
+        snprintf(music->source, MAX_ASSETPATH_LENGTH, "%.*s",
+                sourceLength, source);
 
-        if (Config_disableAudio) continue;
-
-        char filepath[256];
-        snprintf(filepath, 256, "assets/music/%s", source);
-        music->mixMusic = Mix_LoadMUS(filepath);
-        if (!music->mixMusic) Log_warn("Failed to load %s", filepath);
+        _openMusic(music);
     }
 
     Ini_clear();
@@ -80,9 +132,8 @@ void Music_loadFrom(const char* assetpath) {
 
 MusicID Music_find(const char* name) {
     if (!name) return -1;
-    for (int i = 0; i < _musicCount; i++) {
-        if (strcmp(_music[i].name, name) == 0) return i;
-    }
+    int id = NameIndex_find(&_musicIndex, name);
+    if (id != -1) return id;
     Log_warn("Cannot find music %s", name);
     return -1;
 }
@@ -114,30 +165,18 @@ void Sound_loadFrom(const char* assetpath) {
 
         Sound* sound = &_sounds[_soundCount++];
         strncpy(sound->name, name, NAME_LENGTH);
-        
-        const char* source = Ini_get(name, "source");
+        sound->priority = String_parseInt(Ini_get(name, "priority"), 1);
+        sound->maxVoices = String_parseInt(Ini_get(name, "maxVoices"), 4);
+        if (sound->maxVoices < 1) sound->maxVoices = 1;
+
+        int sourceLength;
+        const char* source = Ini_getSlice(name, "source", &sourceLength);
         if (!source) {
             Log_warn("Missing source for %s", name);
             continue;
         }
-
-        if (Config_disableAudio) continue;
-
-        char filepath[256];
-        snprintf(filepath, 256, "assets/sounds/%s", source);
-        sound->mixChunk = Mix_LoadWAV(filepath);
-        if (!sound->mixChunk) {
-            Archive arc = Archive_open("assets/sounds.arc");
-            if (arc) {
-                size_t size = Archive_getSize(arc, source);
-                uint8_t *data = malloc(size);
-                Archive_read(arc, source, size, data);
-                sound->mixChunk = Mix_LoadWAV_RW(SDL_RWFromConstMem(data, (int) size), 1);
-                Archive_close(arc);
-                free(data);
-            }
-        }
-        if (!sound->mixChunk) Log_warn("Failed to load %s", filepath);
+        snprintf(sound->source, MAX_ASSETPATH_LENGTH, "%.*s",
+                sourceLength, source);
     }
 
     Ini_clear();
@@ -145,18 +184,149 @@ void Sound_loadFrom(const char* assetpath) {
 
 SoundID Sound_find(const char* name) {
     if (!name) return -1;
-    for (int i = 0; i < _soundCount; i++) {
-        if (strcmp(_sounds[i].name, name) == 0) return i;
-    }
+    int id = NameIndex_find(&_soundIndex, name);
+    if (id != -1) return id;
     Log_warn("Cannot find sound %s", name);
     return -1;
 }
 
+static void _openMusic(Music* music) {
+    if (Config_disableAudio || !music->source[0]) return;
+
+    char filepath[256];
+    snprintf(filepath, 256, "assets/music/%s", music->source);
+    music->mixMusic = Mix_LoadMUS(filepath);
+    if (!music->mixMusic) Log_warn("Failed to load %s", filepath);
+}
+
+// streams and chunks aren't stored in the game database, load them again
+static void _restoreMusic(void) {
+    for (int i = 0; i < _musicCount; i++) {
+        _music[i].mixMusic = NULL;
+        _openMusic(&_music[i]);
+    }
+}
+
+static void _restoreSounds(void) {
+    for (int i = 0; i < _soundCount; i++) {
+        _sounds[i].mixChunk = NULL;
+    }
+    Residency_clear(ResidentKind_sound);
+}
+
+static Mix_Chunk* _decodeSound(const char* source) {
+    char filepath[SOURCE_LENGTH + 16];
+    snprintf(filepath, sizeof(filepath), "assets/sounds/%s", source);
+    Mix_Chunk* chunk = Mix_LoadWAV(filepath);
+    if (!chunk) {
+        Archive arc = Archive_get("assets/sounds.arc");
+        size_t size;
+        const void* bytes = arc ? Archive_view(arc, source, &size) : NULL;
+        if (bytes) {
+            chunk = Mix_LoadWAV_RW(SDL_RWFromConstMem(bytes, (int) size), 1);
+        }
+    }
+    if (!chunk) Log_warn("Failed to load %s", filepath);
+    return chunk;
+}
+
+// Residency callbacks, chunks are decoded on their first play, or on a
+// loader thread when prefetched
+void Sound_decodeChunk(SoundID self) {
+    Sound* sound = &_sounds[self];
+    if (Config_disableAudio || !sound->source[0]) return;
+    _decodedChunks[self] = _decodeSound(sound->source);
+}
+
+size_t Sound_loadChunk(SoundID self) {
+    if (!_decodedChunks[self]) Sound_decodeChunk(self);
+    Sound* sound = &_sounds[self];
+    sound->mixChunk = _decodedChunks[self];
+    _decodedChunks[self] = NULL;
+    return sound->mixChunk ? sound->mixChunk->alen : 0;
+}
+
+bool Sound_unloadChunk(SoundID self) {
+    Sound* sound = &_sounds[self];
+    int channels = Mix_AllocateChannels(-1);
+    for (int i = 0; i < channels; i++) {
+        if (Mix_Playing(i) && Mix_GetChunk(i) == sound->mixChunk) return false;
+    }
+    Mix_FreeChunk(sound->mixChunk);
+    sound->mixChunk = NULL;
+    return true;
+}
+
+// Decode a sound ahead of its first play
+void Sound_prefetch(SoundID self) {
+    if (self < 0 || self >= _soundCount) return;
+    Residency_prefetch(ResidentKind_sound, self);
+}
+
 void Sound_play(SoundID self) {
     if (Config_muteSounds) return;
-    if (self < 0 || self > _soundCount) return;
+    if (self < 0 || self >= _soundCount) return;
+    if (!Residency_use(ResidentKind_sound, self)) return;
     Sound* sound = &_sounds[self];
-    if (!sound->mixChunk) return;
+    if (!sound->mixChunk || !_opened) return;
+
+    int channel = _findVoice(self);
+    if (channel < 0) return;
+    Voice* voice = &_voices[channel];
+    if (voice->sound == self && voice->started == _tick &&
+            Mix_Playing(channel)) {
+        voice->volume = SDL_min(voice->volume + MERGE_GAIN, MIX_MAX_VOLUME);
+        Mix_Volume(channel, voice->volume);
+        PROFILE_COUNT(audioMerges, 1);
+        return;
+    }
+    if (Mix_Playing(channel)) {
+        Mix_HaltChannel(channel);
+        PROFILE_COUNT(audioSteals, 1);
+    }
+
+    Mix_Volume(channel, VOICE_VOLUME);
+    if (Mix_PlayChannel(channel, sound->mixChunk, 0) < 0) return;
+    *voice = (Voice) {
+        .sound = self,
+        .priority = sound->priority,
+        .started = _tick,
+        .volume = VOICE_VOLUME
+    };
+}
+
+// The voice a sound should play on: one already playing it this tick, the
+// oldest copy if it's at its limit, a free one, or one it can take over.
+// -1 if every voice is busy with something more important.
+static int _findVoice(SoundID self) {
+    Sound* sound = &_sounds[self];
+    int free = -1;
+    int oldestCopy = -1;
+    int copies = 0;
+    int victim = -1;
+    for (int i = 0; i < MAX_VOICES; i++) {
+        Voice* voice = &_voices[i];
+        if (!Mix_Playing(i)) {
+            if (free == -1) free = i;
+            continue;
+        }
+        if (voice->sound == self) {
+            if (voice->started == _tick) return i;
+            copies++;
+            if (oldestCopy == -1 ||
+                    voice->started < _voices[oldestCopy].started) {
+                oldestCopy = i;
+            }
+        }
+        if (voice->priority > sound->priority) continue;
+        if (victim == -1 || voice->priority < _voices[victim].priority ||
+                (voice->priority == _voices[victim].priority &&
+                voice->started < _voices[victim].started)) {
+            victim = i;
+        }
+    }
 
-    Mix_PlayChannel(-1, sound->mixChunk, 0);
+    if (copies >= sound->maxVoices) return oldestCopy;
+    if (free != -1) return free;
+    return victim;
 }
@@ -0,0 +1,349 @@
+#include "common.h"
+
+// Entry point for the helmsgard_bench target. Loads everything without a
+// window or audio, runs the entity systems on region 2 for a number of
+// ticks with extra prefabs spawned around the player, then times a few hot
+// functions on their own. Results are written as JSON so runs can be
+// compared from one build to the next, progress goes to the log.
+
+// ===== [[ Defines ]] =====
+
+#define MAX_BENCH_SPAWNS 16
+#define MAX_BENCH_RESULTS 16
+#define BENCH_WARMUP_TICKS 60 // not counted, lets the world settle
+
+// ===== [[ Local Types ]] =====
+
+typedef struct {
+    const char* prefab;
+    int count;
+} BenchSpawn;
+
+typedef struct {
+    const char* name;
+    int iterations;
+    double totalMs;
+} BenchResult;
+
+// ===== [[ Declarations ]] =====
+
+static bool _parseArgs(int argc, char* argv[]);
+static void _benchSimulation(void);
+static void _benchFindNearest(void);
+static void _benchFindPath(void);
+static void _benchSpriteQueue(void);
+static void _benchIni(void);
+static void _benchArchive(void);
+static void _addResult(const char* name, int iterations, Uint64 begin, Uint64 end);
+static double _elapsedMs(Uint64 begin, Uint64 end);
+static int _compareDoubles(const void* a, const void* b);
+static void _writeJson(FILE* f);
+
+// ===== [[ Static Data ]] =====
+
+static int _ticks = 600;
+static int _iterations = 10000; // per microbenchmark
+static int _radius = 160; // tiles around the player to spawn within
+static const char* _jsonPath;
+static BenchSpawn _spawns[MAX_BENCH_SPAWNS];
+static int _spawnCount;
+
+static int _entityCount;
+static double* _tickMs;
+static BenchResult _results[MAX_BENCH_RESULTS];
+static int _resultCount;
+
+#ifdef HELMSGARD_PROFILE
+// profiler totals as of the end of the simulation, before the
+// microbenchmarks add to them
+static double _scopeMs[ProfileScope_COUNT];
+static int _scopeCalls[ProfileScope_COUNT];
+static int _counterTotals[ProfileCounter_COUNT];
+#endif
+
+// ===== [[ Implementations ]] =====
+
+int Bench_main(int argc, char* argv[]) {
+    if (!_parseArgs(argc, argv)) return 1;
+    Config_disableAudio = true;
+    Config_hotReload = false;
+    Config_showPerf = false;
+
+    // textures still need a renderer, so draw into a plain surface
+    if (SDL_Init(SDL_INIT_EVENTS) < 0) {
+        Log_error("(SDL) %s", SDL_GetError());
+        return 1;
+    }
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0,
+            SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDLAssert(surface);
+    Main_renderer = SDL_CreateSoftwareRenderer(surface);
+    SDLAssert(Main_renderer);
+
+    Uint64 loadBegin = SDL_GetPerformanceCounter();
+    Loading_loadAll();
+    _addResult("load_all", 1, loadBegin, SDL_GetPerformanceCounter());
+
+    _benchIni();
+    _benchArchive();
+
+    Game_enter();
+    _benchSimulation();
+    _benchFindNearest();
+    _benchFindPath();
+    _benchSpriteQueue();
+    Game_leave();
+
+    FILE* f = _jsonPath ? fopen(_jsonPath, "w") : stdout;
+    if (!f) {
+        Log_error("Failed to open %s for writing", _jsonPath);
+    } else {
+        _writeJson(f);
+        if (f != stdout) fclose(f);
+    }
+
+    free(_tickMs);
+    Archive_closeAll();
+    SDL_DestroyRenderer(Main_renderer);
+    SDL_FreeSurface(surface);
+    SDL_Quit();
+    return f ? 0 : 1;
+}
+
+static bool _parseArgs(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            _ticks = String_parseInt(argv[++i], _ticks);
+        } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            _iterations = String_parseInt(argv[++i], _iterations);
+        } else if (strcmp(argv[i], "--radius") == 0 && i + 1 < argc) {
+            _radius = String_parseInt(argv[++i], _radius);
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            _jsonPath = argv[++i];
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            Random_seed(strtoull(argv[++i], NULL, 0));
+        } else if (strcmp(argv[i], "--spawn") == 0 && i + 1 < argc) {
+            // prefab:count, the prefab name is cut off in place
+            char* prefab = argv[++i];
+            char* colon = strchr(prefab, ':');
+            if (_spawnCount == MAX_BENCH_SPAWNS) {
+                Log_warn("Max spawns exceeded, ignoring %s", prefab);
+                continue;
+            }
+            BenchSpawn* spawn = &_spawns[_spawnCount++];
+            spawn->prefab = prefab;
+            spawn->count = 1;
+            if (colon) {
+                *colon = 0;
+                spawn->count = String_parseInt(colon + 1, 1);
+            }
+        } else {
+            Log_error("unknown argument '%s'", argv[i]);
+            return false;
+        }
+    }
+    if (_ticks < 1) _ticks = 1;
+    if (_iterations < 1) _iterations = 1;
+    return true;
+}
+
+// Entity_updateAll on its own, the way Game_update calls it
+static void _benchSimulation(void) {
+    int player = Entity_getPlayer();
+    int px = player != -1 ? Entity_getX(player) : REGION_WIDTH * 128;
+    int py = player != -1 ? Entity_getY(player) : REGION_HEIGHT * 128;
+    for (int i = 0; i < _spawnCount; i++) {
+        int prefab = Entity_findPrefab(_spawns[i].prefab);
+        if (prefab != -1) {
+            Entity_spawnAround(prefab, px, py, _spawns[i].count, _radius);
+        }
+    }
+
+    for (int i = 0; i < BENCH_WARMUP_TICKS; i++) Entity_updateAll();
+#ifdef HELMSGARD_PROFILE
+    Profile_endFrame();
+    Profile_reset();
+#endif
+
+    _entityCount = Entity_getCount();
+    Log_info("bench: %d ticks with %d entities", _ticks, _entityCount);
+
+    _tickMs = calloc(_ticks, sizeof(double));
+    Uint64 begin = SDL_GetPerformanceCounter();
+    for (int i = 0; i < _ticks; i++) {
+        Uint64 tickBegin = SDL_GetPerformanceCounter();
+        Entity_updateAll();
+        _tickMs[i] = _elapsedMs(tickBegin, SDL_GetPerformanceCounter());
+#ifdef HELMSGARD_PROFILE
+        Profile_endFrame();
+#endif
+    }
+    _addResult("entity_update_all", _ticks, begin, SDL_GetPerformanceCounter());
+
+#ifdef HELMSGARD_PROFILE
+    for (int i = 0; i < ProfileScope_COUNT; i++) {
+        _scopeMs[i] = Profile_getScopeMs(i);
+        _scopeCalls[i] = Profile_getScopeCalls(i);
+    }
+    for (int i = 0; i < ProfileCounter_COUNT; i++) {
+        _counterTotals[i] = Profile_getCounterTotal(i);
+    }
+#endif
+}
+
+static void _benchFindNearest(void) {
+    int width = REGION_WIDTH * 256;
+    int height = REGION_HEIGHT * 256;
+    Uint64 begin = SDL_GetPerformanceCounter();
+    for (int i = 0; i < _iterations; i++) {
+        Field_findNearest(Random_int(RandomStream_ai, width),
+                Random_int(RandomStream_ai, height));
+    }
+    _addResult("field_find_nearest", _iterations, begin,
+            SDL_GetPerformanceCounter());
+}
+
+// between random open tiles, so searches aren't cut short by walls
+static void _benchFindPath(void) {
+    int iterations = SDL_max(_iterations / 100, 1);
+    int xs[64], ys[64];
+    int found = 0;
+    Uint64 total = 0;
+    for (int i = 0; i < iterations; i++) {
+        int fromX, fromY, toX, toY;
+        do {
+            fromX = Random_int(RandomStream_ai, REGION_WIDTH);
+            fromY = Random_int(RandomStream_ai, REGION_HEIGHT);
+        } while (Region_isTileSolid(fromX, fromY));
+        do {
+            toX = Random_int(RandomStream_ai, REGION_WIDTH);
+            toY = Random_int(RandomStream_ai, REGION_HEIGHT);
+        } while (Region_isTileSolid(toX, toY));
+
+        Uint64 begin = SDL_GetPerformanceCounter();
+        if (NavGrid_findPath(fromX, fromY, toX, toY, 64, xs, ys) >= 0) found++;
+        total += SDL_GetPerformanceCounter() - begin;
+    }
+    _addResult("navgrid_find_path", iterations, 0, total);
+    Log_info("bench: %d of %d paths found", found, iterations);
+}
+
+// a full queue of sprites that draw nothing, so it's all sorting
+static void _benchSpriteQueue(void) {
+    int iterations = SDL_max(_iterations / 100, 1);
+    Uint64 total = 0;
+    for (int i = 0; i < iterations; i++) {
+        SpriteQueue_clear();
+        for (int j = 0; j < 1024; j++) {
+            SpriteQueue_addSprite(-1, 0,
+                    Random_int(RandomStream_ai, SCREEN_HEIGHT * 4), 0);
+        }
+        Uint64 begin = SDL_GetPerformanceCounter();
+        SpriteQueue_render();
+        total += SDL_GetPerformanceCounter() - begin;
+    }
+    SpriteQueue_clear();
+    _addResult("sprite_queue_sort_1024", iterations, 0, total);
+}
+
+static void _benchIni(void) {
+    int iterations = SDL_max(_iterations / 1000, 1);
+    Uint64 begin = SDL_GetPerformanceCounter();
+    for (int i = 0; i < iterations; i++) {
+        for (int j = 0; j < Loading_tableAssetCount; j++) {
+            Ini_readAsset(Loading_tableAssets[j]);
+            Ini_clear();
+        }
+    }
+    _addResult("ini_parse_tables", iterations, begin,
+            SDL_GetPerformanceCounter());
+}
+
+// opening and unpacking every entry, from a fresh archive each time
+static void _benchArchive(void) {
+    int iterations = SDL_max(_iterations / 1000, 1);
+    Uint64 begin = SDL_GetPerformanceCounter();
+    for (int i = 0; i < iterations; i++) {
+        Archive archive = Archive_open("assets/images.arc");
+        if (!archive) return;
+        int count = Archive_getEntryCount(archive);
+        for (int j = 0; j < count; j++) {
+            Archive_viewEntry(archive, j, NULL);
+        }
+        Archive_close(archive);
+    }
+    _addResult("archive_read_images", iterations, begin,
+            SDL_GetPerformanceCounter());
+}
+
+static void _addResult(const char* name, int iterations, Uint64 begin, Uint64 end) {
+    if (_resultCount == MAX_BENCH_RESULTS) {
+        Log_error("Max bench results exceeded");
+        return;
+    }
+    BenchResult* result = &_results[_resultCount++];
+    result->name = name;
+    result->iterations = iterations;
+    result->totalMs = _elapsedMs(begin, end);
+    Log_info("bench: %-24s %8.4fms x %d", name,
+            result->totalMs / iterations, iterations);
+}
+
+static double _elapsedMs(Uint64 begin, Uint64 end) {
+    return (end - begin) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+static int _compareDoubles(const void* a, const void* b) {
+    double da = *(const double*) a;
+    double db = *(const double*) b;
+    return (da > db) - (da < db);
+}
+
+static void _writeJson(FILE* f) {
+    qsort(_tickMs, _ticks, sizeof(double), _compareDoubles);
+    double sum = 0;
+    for (int i = 0; i < _ticks; i++) sum += _tickMs[i];
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"version\": \"%s\",\n", FAERJOLD_VERSION);
+    fprintf(f, "  \"seed\": %llu,\n", (unsigned long long) Random_getSeed());
+    fprintf(f, "  \"simulation\": {\n");
+    fprintf(f, "    \"ticks\": %d,\n", _ticks);
+    fprintf(f, "    \"entities\": %d,\n", _entityCount);
+    fprintf(f, "    \"tick_ms\": {\"mean\": %.4f, \"p50\": %.4f, "
+            "\"p95\": %.4f, \"max\": %.4f},\n", sum / _ticks,
+            _tickMs[(int) (_ticks * 0.50)], _tickMs[(int) (_ticks * 0.95)],
+            _tickMs[_ticks - 1]);
+    fprintf(f, "    \"systems\": {");
+#ifdef HELMSGARD_PROFILE
+    bool first = true;
+    for (int i = 0; i < ProfileScope_COUNT; i++) {
+        int calls = _scopeCalls[i];
+        if (!calls) continue;
+        fprintf(f, "%s\n      \"%s\": {\"ms_per_tick\": %.4f, \"calls\": %d}",
+                first ? "" : ",", Profile_getScopeName(i),
+                _scopeMs[i] / _ticks, calls);
+        first = false;
+    }
+    fprintf(f, "\n    },\n");
+    fprintf(f, "    \"counters\": {");
+    for (int i = 0; i < ProfileCounter_COUNT; i++) {
+        fprintf(f, "%s\n      \"%s\": %.1f", i ? "," : "",
+                Profile_getCounterName(i),
+                _counterTotals[i] / (double) _ticks);
+    }
+    fprintf(f, "\n    }\n");
+#else
+    fprintf(f, "},\n    \"counters\": {}\n");
+#endif
+    fprintf(f, "  },\n");
+
+    fprintf(f, "  \"benchmarks\": {");
+    for (int i = 0; i < _resultCount; i++) {
+        BenchResult* result = &_results[i];
+        fprintf(f, "%s\n    \"%s\": {\"iterations\": %d, \"ms_per_op\": %.6f}",
+                i ? "," : "", result->name, result->iterations,
+                result->totalMs / result->iterations);
+    }
+    fprintf(f, "\n  }\n}\n");
+}
@@ -3,7 +3,13 @@
 // ===== [[ Defines ]] =====
 
 #define MAX_BFONTS 8
-#define MAX_GLYPHS 128
+#define MAX_GLYPHS 1024
+#define GLYPH_HASH_SIZE 2048 // power of two, at least 2x MAX_GLYPHS
+
+#define TEXT_BUFFER_LENGTH 512
+#define MAX_TEXT_LAYOUTS 64
+#define MAX_TEXT_TEXTURES 16
+#define TEXT_TEXTURE_THRESHOLD 120 // draws before a layout is baked
 
 // ===== [[ Local Types ]] =====
 
@@ -11,6 +17,9 @@ typedef struct {
     char name[NAME_LENGTH];
     bool forceUpper;
     int lookup[128];
+    // open addressing codepoint -> glyph table for non-ascii glyphs
+    int hashCodepoints[GLYPH_HASH_SIZE];
+    int hashGlyphs[GLYPH_HASH_SIZE];
     int codepoints[MAX_GLYPHS];
     int xoffs[MAX_GLYPHS];
     int yoffs[MAX_GLYPHS];
@@ -23,20 +32,65 @@ typedef struct {
     int spaceWidth;
 } BFont;
 
+typedef struct {
+    short glyph;
+    short x;
+    short y;
+} TextQuad;
+
+// laid out string, keyed by (font, hash, maxWidth, halign)
+typedef struct {
+    bool used;
+    BFontID font;
+    uint32_t hash;
+    int maxWidth; // -1 for unwrapped text
+    float halign;
+    uint32_t lastUsed;
+    int useCount;
+    int width;
+    int height;
+    SDL_Texture* texture; // baked once the string has been drawn enough
+    int quadCount;
+    TextQuad quads[TEXT_BUFFER_LENGTH];
+    char text[TEXT_BUFFER_LENGTH];
+} TextLayout;
+
 // ===== [[ Declarations ]] =====
 
 static int _ustack(const char* code, int* stack, int limit);
 static int _findGlyph(BFont* bfont, int codepoint);
+static int _utf8Decode(const char* string, int* length);
+static bool _utf8Contains(const char* string, int codepoint);
+static TextLayout* _getLayout(BFontID font, const char* text,
+        int maxWidth, float halign);
+static void _layoutText(BFont* bfont, TextLayout* layout);
+static void _bakeLayout(TextLayout* layout);
+static void _drawLayout(TextLayout* layout, int x, int y);
+static void _freeLayout(TextLayout* layout);
+static void _restoreTexture(void);
 
 // ===== [[ Static Data ]] =====
 
-static BFont _bfonts[MAX_GLYPHS];
+static BFont _bfonts[MAX_BFONTS];
 static int _bfontCount;
+static NameIndex _bfontIndex = NAME_INDEX(_bfonts, _bfontCount);
 static SDL_Texture* _texBFonts;
 
+static TextLayout _layouts[MAX_TEXT_LAYOUTS];
+static uint32_t _layoutClock;
+static int _textureCount;
+static int _cacheHits;
+static int _cacheMisses;
+
 // ===== [[ Implementations ]] =====
 
+void BFont_registerTables(void) {
+    GameDb_addTable("bfonts", _bfonts, sizeof(BFont),
+            &_bfontCount, MAX_BFONTS, _restoreTexture);
+}
+
 void BFont_load(void) {
+    BFont_invalidateCache();
     Ini_readAsset("bfonts.ini");
 
     for (int i = 0; Ini_getSectionName(i); i++) {
@@ -89,17 +143,28 @@ void BFont_load(void) {
         const char* descenders = Ini_get(name, "descenders");
         for (int i = 0; i < bfont->glyphCount; i++) {
             bfont->descender[i] = (descenders &&
-                strchr(descenders, bfont->codepoints[i]) != 0) ? 3 : 0;
+                _utf8Contains(descenders, bfont->codepoints[i])) ? 3 : 0;
         }
 
-        // build lookup table
+        // build lookup tables
         for (int i = 0; i < 128; i++) {
             bfont->lookup[i] = -1;
         }
+        for (int i = 0; i < GLYPH_HASH_SIZE; i++) {
+            bfont->hashCodepoints[i] = -1;
+        }
         for (int i = 0; i < bfont->glyphCount; i++) {
             int codepoint = bfont->codepoints[i];
             if (codepoint >= 0 && codepoint < 128) {
                 bfont->lookup[codepoint] = i;
+            } else if (codepoint >= 128) {
+                uint32_t slot = (codepoint * 2654435761u) & (GLYPH_HASH_SIZE - 1);
+                while (bfont->hashCodepoints[slot] != -1 &&
+                        bfont->hashCodepoints[slot] != codepoint) {
+                    slot = (slot + 1) & (GLYPH_HASH_SIZE - 1);
+                }
+                bfont->hashCodepoints[slot] = codepoint;
+                bfont->hashGlyphs[slot] = i;
             }
         }
 
@@ -113,62 +178,32 @@ void BFont_load(void) {
 
     Ini_clear();
 
+    _restoreTexture();
+}
+
+static void _restoreTexture(void) {
+    BFont_invalidateCache();
     _texBFonts = Loading_loadTexture("assets/images/bfonts.bmp");
 }
 
 BFontID BFont_find(const char* name) {
     if (!name) return -1;
-    for (int i = 0; i < _bfontCount; i++) {
-        if (strcmp(_bfonts[i].name, name) == 0) return i;
-    }
+    int id = NameIndex_find(&_bfontIndex, name);
+    if (id != -1) return id;
     Log_warn("Cannot find bfont %s", name);
     return -1;
 }
 
 void BFont_drawText(BFontID font, int x, int y, const char* string, ...) {
     if (font < 0 || font > _bfontCount) return;
-    BFont* bfont = &_bfonts[font];
 
-    char buf[256];
+    char buf[TEXT_BUFFER_LENGTH];
     va_list lst;
     va_start(lst, string);
-    vsnprintf(buf, 256, string, lst);
+    vsnprintf(buf, TEXT_BUFFER_LENGTH, string, lst);
     va_end(lst);
 
-    int cx = x;
-    int cy = y;
-    bool needGap = false;
-    for (int i = 0; buf[i]; i++) {
-        char c = buf[i];
-        if (c == ' ') {
-            cx += bfont->spaceWidth;
-            needGap = false;
-        } else if (c == '\n') {
-            cx = x;
-            cy += bfont->height + bfont->lineSpacing;
-            needGap = false;
-        } else {
-            if (bfont->forceUpper && c >= 'a' && c <= 'z') {
-                c += ('A' - 'a');
-            }
-            int glyph = _findGlyph(bfont, c);
-            if (glyph == -1) continue;
-            if (needGap) cx += bfont->charGap;
-
-            SDL_Rect src = {
-                bfont->xoffs[glyph], bfont->yoffs[glyph],
-                bfont->widths[glyph], bfont->height
-            };
-            SDL_Rect dst = {
-                cx, cy + bfont->descender[glyph],
-                bfont->widths[glyph], bfont->height
-            };
-            Draw_translatePoint(&dst.x, &dst.y);
-            SDL_RenderCopy(Main_renderer, _texBFonts, &src, &dst);
-            cx += bfont->widths[glyph];
-            needGap = true;
-        }
-    }
+    _drawLayout(_getLayout(font, buf, -1, 0), x, y);
 }
 
 void BFont_drawTextExt(BFontID font, int x, int y,
@@ -176,17 +211,135 @@ void BFont_drawTextExt(BFontID font, int x, int y,
         const char* string, ...
 ) {
     if (font < 0 || font > _bfontCount) return;
-    BFont* bfont = &_bfonts[font];
 
-    char buf[512];
+    char buf[TEXT_BUFFER_LENGTH];
     va_list lst;
     va_start(lst, string);
-    vsnprintf(buf, 512, string, lst);
+    vsnprintf(buf, TEXT_BUFFER_LENGTH, string, lst);
     va_end(lst);
 
+    _drawLayout(_getLayout(font, buf, maxWidth, halign), x, y);
+}
+
+// Drop all cached layouts and baked textures
+void BFont_invalidateCache(void) {
+    for (int i = 0; i < MAX_TEXT_LAYOUTS; i++) {
+        _freeLayout(&_layouts[i]);
+    }
+}
+
+void BFont_getCacheStats(int* hits, int* misses, int* textures) {
+    if (hits) *hits = _cacheHits;
+    if (misses) *misses = _cacheMisses;
+    if (textures) *textures = _textureCount;
+}
+
+static uint32_t _hashText(const char* text) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; text[i]; i++) {
+        hash = (hash ^ (uint8_t) text[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Find a cached layout for text, laying it out if not present
+static TextLayout* _getLayout(BFontID font, const char* text,
+        int maxWidth, float halign
+) {
+    uint32_t hash = _hashText(text);
+    TextLayout* lru = &_layouts[0];
+    _layoutClock++;
+
+    for (int i = 0; i < MAX_TEXT_LAYOUTS; i++) {
+        TextLayout* layout = &_layouts[i];
+        if (!layout->used) {
+            if (lru->used) lru = layout;
+            continue;
+        }
+        if (layout->hash == hash && layout->font == font &&
+                layout->maxWidth == maxWidth && layout->halign == halign &&
+                strcmp(layout->text, text) == 0) {
+            _cacheHits++;
+            layout->lastUsed = _layoutClock;
+            layout->useCount++;
+            if (!layout->texture && layout->useCount == TEXT_TEXTURE_THRESHOLD) {
+                _bakeLayout(layout);
+            }
+            return layout;
+        }
+        if (lru->used && layout->lastUsed < lru->lastUsed) lru = layout;
+    }
+
+    // evict least recently used
+    _cacheMisses++;
+    _freeLayout(lru);
+    lru->used = true;
+    lru->font = font;
+    lru->hash = hash;
+    lru->maxWidth = maxWidth;
+    lru->halign = halign;
+    lru->lastUsed = _layoutClock;
+    lru->useCount = 1;
+    strncpy(lru->text, text, TEXT_BUFFER_LENGTH - 1);
+    lru->text[TEXT_BUFFER_LENGTH - 1] = 0;
+    _layoutText(&_bfonts[font], lru);
+    return lru;
+}
+
+static void _addQuad(BFont* bfont, TextLayout* layout, int glyph, int x, int y) {
+    TextQuad* quad = &layout->quads[layout->quadCount++];
+    quad->glyph = glyph;
+    quad->x = x;
+    quad->y = y;
+    if (x + bfont->widths[glyph] > layout->width) {
+        layout->width = x + bfont->widths[glyph];
+    }
+    if (y + bfont->descender[glyph] + bfont->height > layout->height) {
+        layout->height = y + bfont->descender[glyph] + bfont->height;
+    }
+}
+
+// Lay out layout->text into glyph quads relative to the text origin
+static void _layoutText(BFont* bfont, TextLayout* layout) {
+    const char* buf = layout->text;
+    int maxWidth = layout->maxWidth;
+    layout->quadCount = 0;
+    layout->width = 0;
+    layout->height = 0;
+
+    if (maxWidth < 0) {
+        int cx = 0;
+        int cy = 0;
+        bool needGap = false;
+        int length;
+        for (int i = 0; buf[i]; i += length) {
+            int c = _utf8Decode(buf + i, &length);
+            if (c == ' ') {
+                cx += bfont->spaceWidth;
+                needGap = false;
+            } else if (c == '\n') {
+                cx = 0;
+                cy += bfont->height + bfont->lineSpacing;
+                needGap = false;
+            } else {
+                if (bfont->forceUpper && c >= 'a' && c <= 'z') {
+                    c += ('A' - 'a');
+                }
+                int glyph = _findGlyph(bfont, c);
+                if (glyph == -1) continue;
+                if (needGap) cx += bfont->charGap;
+
+                _addQuad(bfont, layout, glyph, cx, cy + bfont->descender[glyph]);
+                cx += bfont->widths[glyph];
+                needGap = true;
+            }
+        }
+        return;
+    }
+
     int rowStart = 0;
-    int cx = x;
-    int cy = y;
+    int cx = 0;
+    int cy = 0;
     int curr = 0;
     bool needGap = false;
     while (buf[curr]) {
@@ -196,7 +349,8 @@ void BFont_drawTextExt(BFontID font, int x, int y,
         int rowWidthCandidate = 0;
         needGap = false;
         while (rowWidth <= maxWidth || rowEnd == rowStart) {
-            char c = buf[curr];
+            int length;
+            int c = _utf8Decode(buf + curr, &length);
             if (c == 0) {
                 rowEnd = curr;
                 rowWidthCandidate = rowWidth;
@@ -216,20 +370,21 @@ void BFont_drawTextExt(BFontID font, int x, int y,
                     c += ('A' - 'a');
                 }
                 int glyph = _findGlyph(bfont, c);
-                if (glyph == -1) continue;
-                if (needGap) rowWidth += bfont->charGap;
-
-                rowWidth += bfont->widths[glyph];
-                needGap = true;
+                if (glyph != -1) {
+                    if (needGap) rowWidth += bfont->charGap;
+                    rowWidth += bfont->widths[glyph];
+                    needGap = true;
+                }
             }
-            curr++;
+            curr += length;
         }
 
-        // draw row
-        cx = x + (maxWidth - rowWidthCandidate) * halign;
+        // lay out row
+        cx = (maxWidth - rowWidthCandidate) * layout->halign;
         needGap = false;
-        for (int i = rowStart; i < rowEnd; i++) {
-            char c = buf[i];
+        int length;
+        for (int i = rowStart; i < rowEnd; i += length) {
+            int c = _utf8Decode(buf + i, &length);
             if (c == ' ') {
                 cx += bfont->spaceWidth;
                 needGap = false;
@@ -241,16 +396,7 @@ void BFont_drawTextExt(BFontID font, int x, int y,
                 if (glyph == -1) continue;
                 if (needGap) cx += bfont->charGap;
 
-                SDL_Rect src = {
-                    bfont->xoffs[glyph], bfont->yoffs[glyph],
-                    bfont->widths[glyph], bfont->height
-                };
-                SDL_Rect dst = {
-                    cx, cy + bfont->descender[glyph],
-                    bfont->widths[glyph], bfont->height
-                };
-                Draw_translatePoint(&dst.x, &dst.y);
-                SDL_RenderCopy(Main_renderer, _texBFonts, &src, &dst);
+                _addQuad(bfont, layout, glyph, cx, cy + bfont->descender[glyph]);
                 cx += bfont->widths[glyph];
                 needGap = true;
             }
@@ -264,6 +410,85 @@ void BFont_drawTextExt(BFontID font, int x, int y,
     }
 }
 
+// Render a hot layout into its own texture so it draws with one copy
+static void _bakeLayout(TextLayout* layout) {
+    if (_textureCount == MAX_TEXT_TEXTURES) return;
+    if (layout->quadCount == 0) return;
+    // aligned rows may start left of the origin, keep those on the slow path
+    for (int i = 0; i < layout->quadCount; i++) {
+        if (layout->quads[i].x < 0 || layout->quads[i].y < 0) return;
+    }
+
+    SDL_Texture* texture = SDL_CreateTexture(Main_renderer,
+            SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET,
+            layout->width, layout->height);
+    if (!texture) return;
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+    SDL_Texture* prevTarget = SDL_GetRenderTarget(Main_renderer);
+    SDL_Rect prevClip;
+    bool hadClip = SDL_RenderIsClipEnabled(Main_renderer);
+    SDL_RenderGetClipRect(Main_renderer, &prevClip);
+    Uint8 r, g, b, a;
+    SDL_GetRenderDrawColor(Main_renderer, &r, &g, &b, &a);
+
+    SDL_SetRenderTarget(Main_renderer, texture);
+    SDL_RenderSetClipRect(Main_renderer, NULL);
+    SDL_SetRenderDrawColor(Main_renderer, 0, 0, 0, 0);
+    SDL_RenderClear(Main_renderer);
+
+    BFont* bfont = &_bfonts[layout->font];
+    for (int i = 0; i < layout->quadCount; i++) {
+        TextQuad* quad = &layout->quads[i];
+        SDL_Rect src = {
+            bfont->xoffs[quad->glyph], bfont->yoffs[quad->glyph],
+            bfont->widths[quad->glyph], bfont->height
+        };
+        SDL_Rect dst = { quad->x, quad->y, src.w, src.h };
+        SDL_RenderCopy(Main_renderer, _texBFonts, &src, &dst);
+        PROFILE_COUNT(renderCopies, 1);
+    }
+
+    SDL_SetRenderTarget(Main_renderer, prevTarget);
+    SDL_RenderSetClipRect(Main_renderer, hadClip ? &prevClip : NULL);
+    SDL_SetRenderDrawColor(Main_renderer, r, g, b, a);
+
+    layout->texture = texture;
+    _textureCount++;
+}
+
+static void _drawLayout(TextLayout* layout, int x, int y) {
+    if (layout->texture) {
+        SDL_Rect dst = { x, y, layout->width, layout->height };
+        Draw_translatePoint(&dst.x, &dst.y);
+        SDL_RenderCopy(Main_renderer, layout->texture, NULL, &dst);
+        PROFILE_COUNT(renderCopies, 1);
+        return;
+    }
+
+    BFont* bfont = &_bfonts[layout->font];
+    for (int i = 0; i < layout->quadCount; i++) {
+        TextQuad* quad = &layout->quads[i];
+        SDL_Rect src = {
+            bfont->xoffs[quad->glyph], bfont->yoffs[quad->glyph],
+            bfont->widths[quad->glyph], bfont->height
+        };
+        SDL_Rect dst = { x + quad->x, y + quad->y, src.w, src.h };
+        Draw_translatePoint(&dst.x, &dst.y);
+        SDL_RenderCopy(Main_renderer, _texBFonts, &src, &dst);
+        PROFILE_COUNT(renderCopies, 1);
+    }
+}
+
+static void _freeLayout(TextLayout* layout) {
+    if (layout->texture) {
+        SDL_DestroyTexture(layout->texture);
+        _textureCount--;
+    }
+    layout->texture = NULL;
+    layout->used = false;
+}
+
 static int _ustack(const char* code, int* stack, int limit) {
     if (!code) return 0;
     const char* curr = code;
@@ -273,9 +498,11 @@ static int _ustack(const char* code, int* stack, int limit) {
         switch (*curr) {
             case '.': {
                 curr++;
-                if (!curr) goto bad_eol;
+                if (!*curr) goto bad_eol;
                 if (size == limit) goto overflow;
-                stack[size++] = *curr;
+                int length;
+                stack[size++] = _utf8Decode(curr, &length);
+                curr += length - 1;
             } break;
             case '~': {
                 if (size < 2) goto underflow;
@@ -363,11 +590,13 @@ static int _findGlyph(BFont* bfont, int codepoint) {
     int result = -1;
     if (codepoint >= 0 && codepoint < 128) {
         result = bfont->lookup[codepoint];
-    } else {
-        for (int i = 0; i < bfont->glyphCount; i++) {
-            if (bfont->codepoints[i] == codepoint) {
-                return i;
+    } else if (codepoint >= 128) {
+        uint32_t slot = (codepoint * 2654435761u) & (GLYPH_HASH_SIZE - 1);
+        while (bfont->hashCodepoints[slot] != -1) {
+            if (bfont->hashCodepoints[slot] == codepoint) {
+                return bfont->hashGlyphs[slot];
             }
+            slot = (slot + 1) & (GLYPH_HASH_SIZE - 1);
         }
     }
 
@@ -378,3 +607,41 @@ static int _findGlyph(BFont* bfont, int codepoint) {
     }
     return result;
 }
+
+// Decode one UTF-8 codepoint, bytes that aren't valid UTF-8 are
+// treated as Latin-1
+static int _utf8Decode(const char* string, int* length) {
+    const uint8_t* s = (const uint8_t*) string;
+    int count = 0;
+    int codepoint = s[0];
+    if (s[0] >= 0xF8) {
+        // not a lead byte, left as Latin-1
+    } else if (s[0] >= 0xF0) {
+        count = 3;
+        codepoint = s[0] & 0x07;
+    } else if (s[0] >= 0xE0) {
+        count = 2;
+        codepoint = s[0] & 0x0F;
+    } else if (s[0] >= 0xC0) {
+        count = 1;
+        codepoint = s[0] & 0x1F;
+    }
+
+    for (int i = 1; i <= count; i++) {
+        if ((s[i] & 0xC0) != 0x80) {
+            *length = 1;
+            return s[0];
+        }
+        codepoint = (codepoint << 6) | (s[i] & 0x3F);
+    }
+    *length = count + 1;
+    return codepoint;
+}
+
+static bool _utf8Contains(const char* string, int codepoint) {
+    int length;
+    for (int i = 0; string[i]; i += length) {
+        if (_utf8Decode(string + i, &length) == codepoint) return true;
+    }
+    return false;
+}
@@ -10,9 +10,20 @@ typedef struct {
     char value[MAX_VALUE];
 } CommandVar;
 
+// worst case loads for the bench command
+typedef struct {
+    const char* name;
+    const char* prefab; // spawned around the player, may be NULL
+    int count;
+    int radius; // pixels
+    const char* particles; // pool filled from this system, may be NULL
+    int particleCount;
+} BenchScenario;
+
 // ===== [[ Declarations ]] =====
 
 #define MAX_VARIABLES 256
+#define BENCH_FRAMES 600
 
 static const char* _nextToken(void);
 static CommandVar* _findVariable(const char* name);
@@ -32,13 +43,25 @@ static void _commandGive(void);
 static void _commandEdit(void);
 static void _commandStatusFX(void);
 static void _commandQuest(void);
+static void _commandSpawn(void);
+static void _commandParticles(void);
+static void _commandProfile(void);
+static void _commandBench(void);
 static void _commandHelp(void);
+static int _spawnAroundPlayer(int prefab, int count, int radius);
+static int _fillParticles(ParticlesID particles, int count);
 
 // ===== [[ Static Data ]] =====
 
 static char _command[512];
 static CommandVar _variables[MAX_VARIABLES];
 
+static const BenchScenario _scenarios[] = {
+    { "slimes", "slime", 200, 160, NULL, 0 },
+    { "particles", NULL, 0, 0, "pt_slimebits", 4096 },
+    { "swarm", "slime", 100, 240, "pt_poofCloud", 2048 },
+};
+
 // ===== [[ Implementations ]] =====
 
 void Command_execute(const char* command) {
@@ -56,6 +79,10 @@ void Command_execute(const char* command) {
     else if (strcmp(operation, "edit") == 0) _commandEdit();
     else if (strcmp(operation, "statusfx") == 0) _commandStatusFX();
     else if (strcmp(operation ,"quest") == 0) _commandQuest();
+    else if (strcmp(operation, "spawn") == 0) _commandSpawn();
+    else if (strcmp(operation, "particles") == 0) _commandParticles();
+    else if (strcmp(operation, "profile") == 0) _commandProfile();
+    else if (strcmp(operation, "bench") == 0) _commandBench();
     else if (strcmp(operation, "help") == 0) _commandHelp();
     else Log_error("unknown command %s", operation);
 }
@@ -146,9 +173,9 @@ static void _commandGet(void) {
     do {
         const char* value = _getvar(name);
         if (value) {
-            Log_debug("%s = %s", name, value);
+            Log_info("%s = %s", name, value);
         } else {
-            Log_debug("%s undefined", name);
+            Log_info("%s undefined", name);
         }
     } while ((name = _nextToken()));
     return;
@@ -304,6 +331,112 @@ static void _commandQuest(void) {
     return;
 }
 
+static void _commandSpawn(void) {
+    const char* prefabName = _nextToken();
+    if (!prefabName) goto format_error;
+    const char* countStr = _nextToken();
+    if (!countStr) goto format_error;
+    int count = String_parseInt(countStr, 1);
+    int radius = String_parseInt(_nextToken(), 64);
+    if (_nextToken()) goto format_error;
+
+    int prefab = Entity_findPrefab(prefabName);
+    if (prefab == -1) return;
+
+    int spawned = _spawnAroundPlayer(prefab, count, radius);
+    Log_info("spawned %d %s, %d entities", spawned, prefabName,
+            Entity_getCount());
+    return;
+
+    format_error:
+    Log_error("usage: spawn <prefab> <count> [radius]");
+    return;
+}
+
+static void _commandParticles(void) {
+    const char* name = _nextToken();
+    if (!name) goto format_error;
+    const char* countStr = _nextToken();
+    if (!countStr) goto format_error;
+    if (_nextToken()) goto format_error;
+
+    ParticlesID particles = Particles_find(name);
+    if (particles == -1) return;
+
+    int spawned = _fillParticles(particles, String_parseInt(countStr, 1));
+    Log_info("spawned %d particles, %d live", spawned, Particles_getCount());
+    return;
+
+    format_error:
+    Log_error("usage: particles <name> <count>");
+    return;
+}
+
+static void _commandProfile(void) {
+    const char* action = _nextToken();
+    if (!action) goto format_error;
+    const char* path = _nextToken();
+    if (_nextToken()) goto format_error;
+
+#ifdef HELMSGARD_PROFILE
+    if (strcmp(action, "start") == 0) {
+        Profile_reset();
+        Log_info("profiling, stop with profile stop <file>");
+    } else if (strcmp(action, "stop") == 0 && path) {
+        Profile_writeCsv(path);
+    } else {
+        goto format_error;
+    }
+#else
+    (void) path;
+    Log_error("built without HELMSGARD_PROFILE");
+#endif
+    return;
+
+    format_error:
+    Log_error("usage: profile start|stop <file>");
+    return;
+}
+
+static void _commandBench(void) {
+    const char* name = _nextToken();
+    if (!name) goto format_error;
+    if (_nextToken()) goto format_error;
+
+    const BenchScenario* scenario = NULL;
+    for (int i = 0; i < countof(_scenarios); i++) {
+        if (strcmp(_scenarios[i].name, name) == 0) scenario = &_scenarios[i];
+    }
+    if (!scenario) goto value_error;
+    if (Pacer_isCapturing()) {
+        Log_warn("a bench is already running");
+        return;
+    }
+
+    if (scenario->prefab) {
+        int prefab = Entity_findPrefab(scenario->prefab);
+        if (prefab != -1) {
+            _spawnAroundPlayer(prefab, scenario->count, scenario->radius);
+        }
+    }
+    if (scenario->particles) {
+        ParticlesID particles = Particles_find(scenario->particles);
+        if (particles != -1) _fillParticles(particles, scenario->particleCount);
+    }
+    Log_info("bench %s: %d entities, %d particles, measuring %d frames",
+            name, Entity_getCount(), Particles_getCount(), BENCH_FRAMES);
+    Pacer_startCapture(name, BENCH_FRAMES);
+    return;
+
+    format_error:
+    Log_error("usage: bench <scenario>");
+    return;
+
+    value_error:
+    Log_error("unknown scenario %s, try slimes, particles or swarm", name);
+    return;
+}
+
 static void _commandHelp(void) {
     if (_nextToken()) goto format_error;
 
@@ -312,6 +445,10 @@ static void _commandHelp(void) {
     Log_info("noclip [on|off]        - toggles noclip");
     Log_info("sethp <amount>         - sets player hp");
     Log_info("give <item> [quantity] - give player an item");
+    Log_info("spawn <prefab> <count> [radius] - spawn around the player");
+    Log_info("particles <name> <count> - spawn particles on the player");
+    Log_info("profile start|stop <file> - write system timings to a file");
+    Log_info("bench <scenario>       - time frames under load (slimes, particles, swarm)");
     Log_info("help                   - lists commands");
     
     return;
@@ -320,3 +457,29 @@ static void _commandHelp(void) {
     Log_error("usage: help");
     return;
 }
+
+// Returns how many were spawned before running out of entities
+static int _spawnAroundPlayer(int prefab, int count, int radius) {
+    int player = Entity_getPlayer();
+    if (player == -1) return 0;
+    return Entity_spawnAround(prefab, Entity_getX(player),
+            Entity_getY(player), count, radius);
+}
+
+// Spawns the system on the player until count more particles are live or
+// the pool is full
+static int _fillParticles(ParticlesID particles, int count) {
+    int player = Entity_getPlayer();
+    if (player == -1) return 0;
+    int x = Entity_getX(player);
+    int y = Entity_getY(player);
+
+    int before = Particles_getCount();
+    int live = before;
+    while (live - before < count) {
+        Particles_spawn(particles, x, y, 0);
+        if (Particles_getCount() == live) break; // pool full
+        live = Particles_getCount();
+    }
+    return live - before;
+}
@@ -18,6 +18,7 @@
 #define FAERJOLD_VERSION "23.06"
 #define SCREEN_WIDTH 426
 #define SCREEN_HEIGHT 240
+#define TICK_RATE 60 // simulation updates per second
 
 #define DEG_TO_RAD(f) ((f) * 0.0174533f)
 #define RAD_TO_DEG(f) ((f) * 57.2958f)
@@ -55,8 +56,49 @@
 #define LOAD_SPRITE_IMAGE(_name) \
         (LoadingRequest) { .type = 8, .name = _name }
 
+// per-system scope timers and counters, see profile.c
+#ifdef HELMSGARD_PROFILE
+#define PROFILE_BEGIN(_scope) Profile_begin(ProfileScope_##_scope)
+#define PROFILE_END(_scope) Profile_end(ProfileScope_##_scope)
+#define PROFILE_COUNT(_counter, _amount) \
+        (Profile_counters[ProfileCounter_##_counter] += (_amount))
+#else
+// still a trace zone, as Profile_begin would make one
+#define PROFILE_BEGIN(_scope) Trace_begin(#_scope)
+#define PROFILE_END(_scope) Trace_end()
+#define PROFILE_COUNT(_counter, _amount) ((void) 0)
+#endif
+
+// logging by category, see log.c. debug lines aren't compiled into release
+// builds at all, and LOG_LIMITED prints at most once per LOG_LIMIT_MS
+#ifdef NDEBUG
+#define LOG_MAX_LEVEL LogLevel_info
+#else
+#define LOG_MAX_LEVEL LogLevel_debug
+#endif
+#define LOG_LIMIT_MS 1000
+#define LOG_AT(_level, _category, ...) \
+        do { if (LogLevel_##_level <= LOG_MAX_LEVEL) Log_write( \
+        LogLevel_##_level, LogCategory_##_category, __VA_ARGS__); } while (0)
+#define LOG_ERROR(_category, ...) LOG_AT(error, _category, __VA_ARGS__)
+#define LOG_WARN(_category, ...) LOG_AT(warn, _category, __VA_ARGS__)
+#define LOG_INFO(_category, ...) LOG_AT(info, _category, __VA_ARGS__)
+#define LOG_DEBUG(_category, ...) LOG_AT(debug, _category, __VA_ARGS__)
+#define LOG_LIMITED(_level, _category, ...) \
+        do { static LogLimit _limit; int _suppressed; \
+        if (Log_limit(&_limit, &_suppressed)) { \
+            LOG_AT(_level, _category, __VA_ARGS__); \
+            if (_suppressed) LOG_AT(_level, _category, \
+                    "(and %d more like that)", _suppressed); \
+        } } while (0)
+#define Log_debug(...) LOG_DEBUG(general, __VA_ARGS__)
+
 #define countof(_array) (sizeof(_array) / sizeof(_array[0]))
 
+#define NAME_INDEX(_array, _count) \
+        { .names = (_array)[0].name, .stride = sizeof((_array)[0]), \
+        .count = &(_count) }
+
 // ===== [[ Handle Types ]] =====
 
 typedef int AnimationID;
@@ -66,6 +108,7 @@ typedef int DialogID;
 typedef int DialogLineID;
 typedef int ItemID;
 typedef int ItemTypeID;
+typedef int LoadJobID;
 typedef int LootTableID;
 typedef int MusicID;
 typedef int ParticlesID;
@@ -77,6 +120,7 @@ typedef int SpriteID;
 typedef int StatusEffectID;
 typedef int VillagerID;
 typedef struct archive* Archive;
+typedef struct imageJob* DecodedImage;
 
 // ===== [[ Enum Types ]] =====
 
@@ -128,6 +172,15 @@ typedef enum {
     Facing_down
 } Facing;
 
+typedef enum {
+    FramePhase_update,
+    FramePhase_render,
+    FramePhase_present,
+    FramePhase_frame, // start of one frame to the next
+
+    FramePhase_COUNT
+} FramePhase;
+
 typedef enum {
     InputButton_accept, // A
     InputButton_back, // B
@@ -174,6 +227,23 @@ typedef enum {
     InputSource_controller
 } InputSource;
 
+typedef enum {
+    LogCategory_general,
+    LogCategory_assets,
+    LogCategory_audio,
+    LogCategory_entity,
+    LogCategory_graphics,
+
+    LogCategory_COUNT
+} LogCategory;
+
+typedef enum {
+    LogLevel_error,
+    LogLevel_warn,
+    LogLevel_info,
+    LogLevel_debug
+} LogLevel;
+
 typedef enum {
     MainState_invalid,
     MainState_loading,
@@ -183,6 +253,49 @@ typedef enum {
     MainState_editor
 } MainState;
 
+typedef enum {
+    ProfileCounter_queryRows,
+    ProfileCounter_findNearest,
+    ProfileCounter_pathSearches,
+    ProfileCounter_renderCopies,
+    ProfileCounter_audioVoices,
+    ProfileCounter_audioSteals,
+    ProfileCounter_audioMerges,
+
+    ProfileCounter_COUNT
+} ProfileCounter;
+
+typedef enum {
+    ProfileScope_storeLocations,
+    ProfileScope_updatePlayerControllers,
+    ProfileScope_updateEnemyControllers,
+    ProfileScope_followPaths,
+    ProfileScope_updateBoss,
+    ProfileScope_updateIntent,
+    ProfileScope_updateAttack,
+    ProfileScope_updateHurt,
+    ProfileScope_updateRolling,
+    ProfileScope_updateAlert,
+    ProfileScope_updateStatusEffects,
+    ProfileScope_updateBeingCollected,
+    ProfileScope_updateShake,
+    ProfileScope_updateLaunch,
+    ProfileScope_updateHint,
+    ProfileScope_entityMotion,
+    ProfileScope_entityIntersections,
+    ProfileScope_fieldIntersections,
+    ProfileScope_renderAnimations,
+    ProfileScope_renderSprites,
+    ProfileScope_renderMarkers,
+    ProfileScope_regionRender,
+    ProfileScope_spriteQueueRender,
+    ProfileScope_particlesUpdate,
+    ProfileScope_particlesDraw,
+    ProfileScope_findPath,
+
+    ProfileScope_COUNT
+} ProfileScope;
+
 typedef enum {
     QuestEvent_talk,
     QuestEvent_defeat,
@@ -191,6 +304,23 @@ typedef enum {
     QuestEvent_defeatBoss
 } QuestEvent;
 
+typedef enum {
+    RandomStream_combat,
+    RandomStream_loot,
+    RandomStream_ai,
+    RandomStream_particles,
+    RandomStream_dialog,
+
+    RandomStream_COUNT
+} RandomStream;
+
+typedef enum {
+    ResidentKind_image,
+    ResidentKind_sound,
+
+    ResidentKind_COUNT
+} ResidentKind;
+
 typedef enum {
     Stat_atk,
     Stat_def,
@@ -214,6 +344,42 @@ typedef struct {
     bool isInside;
 } FieldNearest;
 
+// one tick of input, as recorded by replays
+typedef struct {
+    uint16_t buttons; // bit per InputButton
+    int16_t axisX; // raw controller axes
+    int16_t axisY;
+    InputSource source;
+} InputFrame;
+
+// state for one LOG_LIMITED call site
+typedef struct {
+    SDL_atomic_t next; // ticks before which it stays quiet
+    SDL_atomic_t suppressed;
+    bool started;
+} LogLimit;
+
+typedef void (*SpriteQueueBatchFn)(int arg);
+
+typedef void (*LoadJobFn)(void* data);
+
+typedef void (*GameDbRestoreFn)(void);
+
+typedef void (*IniReadFn)(const char* filepath);
+
+// hashed name lookup over a table of structs with a name field
+typedef struct {
+    const char* names; // name of the first element
+    int stride; // bytes from one name to the next
+    int* count; // the table's element count
+    int indexed; // elements added to the index so far
+    int generation;
+    int slotCount; // power of two
+    int used;
+    int* slots; // element id, -1 if empty
+    uint32_t* hashes;
+} NameIndex;
+
 typedef struct {
     bool invert;
     int operator; // 0: AND, 1: OR, 2: XOR
@@ -223,10 +389,11 @@ typedef struct {
 
 void Animation_loadFrom(const char* assetpath);
 AnimationID Animation_find(const char* name);
+void Animation_prefetch(AnimationID self);
 int Animation_getDuration(AnimationID self);
 // draw animation at given spot
 // if time is NULL, will use global timer
-// else will use time stored and update it
+// else will use time stored (advanced by the owner, not here)
 void Animation_draw(AnimationID self, int x, int y, int* timePointer);
 void Animation_update(void);
 
@@ -234,13 +401,20 @@ void Attack_loadFrom(const char* assetpath);
 int Attack_find(const char* name);
 
 void Audio_startup(void);
+void Audio_registerTables(void);
+void Audio_update(void); // once per tick, sounds from one tick are merged
+
+int Bench_main(int argc, char* argv[]); // helmsgard_bench only
 
+void BFont_registerTables(void);
 void BFont_load(void);
 BFontID BFont_find(const char* name);
 void BFont_drawText(BFontID font, int x, int y, const char* string, ...);
 void BFont_drawTextExt(BFontID font, int x, int y,
         int maxWidth, float halign,
         const char* string, ...);
+void BFont_invalidateCache(void);
+void BFont_getCacheStats(int* hits, int* misses, int* textures);
 
 extern const SDL_Color Color_aqua;
 extern const SDL_Color Color_black;
@@ -271,19 +445,27 @@ void Console_render(void);
 bool Console_shouldClose(void);
 
 extern int Config_displayMode;
+extern int Config_frameRate;
+extern bool Config_vsync;
 extern char Config_assetDirectory[256];
+extern char Config_assetArchive[256];
+extern char Config_gameDatabase[256];
 extern bool Config_muteMusic;
 extern bool Config_muteSounds;
 extern bool Config_disableAudio;
+extern int Config_assetBudget;
 extern bool Config_showPerf;
 extern bool Config_showCollision;
 extern bool Config_showNavGrid;
+extern bool Config_hotReload;
 extern float Config_deadzoneX;
 extern float Config_deadzoneY;
 extern int Config_logLevel;
+extern int Config_logLevels[LogCategory_COUNT]; // [Log] section
 void Config_load(void);
 
 // todo: maybe dont expose triggers, only expose DialogLine?
+void Dialog_registerTables(void);
 void Dialog_load(void);
 DialogID Dialog_find(const char* name);
 DialogLineID Dialog_findLine(const char* name);
@@ -323,14 +505,23 @@ void Editor_render(void);
 void Editor_setRegion(int regionID);
 
 //extern Entity Entity_table[256];
+void Entity_init(void);
+void Entity_registerTables(void);
 void Entity_loadPrefabsFrom(const char* assetpath);
 void Entity_updateAll(void);
+void Entity_updateAnimations(bool advance);
 void Entity_renderAll(void);
 int Entity_spawn(int x, int y, int prefabID);
+int Entity_spawnAround(int prefabID, int x, int y, int count, int radius);
 void Entity_destroy(int id);
 void Entity_destroyAll(void);
+void Entity_destroyAllBut(int keep);
+void Entity_destroyPlayersBut(int keep);
 int Entity_getPlayer(void);
+int Entity_getCount(void);
 int Entity_findPrefab(const char* name);
+void Entity_prefetchPrefab(int prefabID);
+uint32_t Entity_getChecksum(void);
 void Entity_dropItem(int x, int y, ItemID item);
 void Entity_dropGold(int x, int y, int amount);
 void Entity_addStatusEffect(int id, StatusEffectID seID);
@@ -375,6 +566,7 @@ void Game_leave(void);
 void Game_update(void);
 void Game_render(void);
 void Game_reload(void);
+void Game_reloadRegion(void);
 void Game_setDialog(int entity);
 void Game_setCrafting(void);
 void Game_setHitstop(int frames);
@@ -387,16 +579,30 @@ void Game_setWon(void);
 void Game_setHintText(const char* text);
 void Game_addGold(int amount);
 
+// tables are registered by each module's *_registerTables
+void GameDb_addTable(const char* name, void* data, int size, int* count,
+        int max, GameDbRestoreFn restore);
+bool GameDb_write(const char* path);
+bool GameDb_load(const char* path);
+// copy of every table, to put back if a hot reload goes wrong
+void* GameDb_snapshot(void);
+void GameDb_restoreSnapshot(void* snapshot);
+void GameDb_freeSnapshot(void* snapshot);
+
 void Graphics_setModulationColor(int r, int g, int b);
 void Graphics_clearModulationColor(void);
 
 void Ini_clear(void);
 bool Ini_readFile(const char* filepath);
 bool Ini_readAsset(const char* assetpath);
+bool Ini_readMemory(const char* data, size_t size);
 bool Ini_writeFile(const char* filepath);
 const char* Ini_getSectionName(int index); // used for looping
 const char* Ini_get(const char* section, const char* key);
+const char* Ini_getSlice(const char* section, const char* key, int* length);
 bool Ini_set(const char* section, const char* key, const char* value);
+void Ini_benchmark(const char* const* assetpaths, int count, int iterations);
+void Ini_setReadHook(IniReadFn hook); // called with every file read
 
 void Input_update(void);
 void Input_processEvent(SDL_Event* event);
@@ -432,6 +638,7 @@ SlotID Inventory_find(ItemID item);
 int Inventory_getSize(void);
 void Inventory_compact(void);
 
+void Item_registerTables(void);
 void Item_loadFrom(const char* assetpath);
 ItemID Item_find(const char* name);
 const char* Item_getName(ItemID self);
@@ -461,12 +668,30 @@ void Loading_leave(void);
 void Loading_update(void);
 void Loading_render(void);
 SDL_Texture* Loading_loadTexture(const char* name);
-void Loading_loadSpriteImage(const char* name);
-
+DecodedImage Loading_decodeImage(const char* name); // any thread
+SDL_Texture* Loading_uploadImage(DecodedImage image);
+void Loading_loadAll(void); // every module, right away
+extern const char* const Loading_tableAssets[];
+extern const int Loading_tableAssetCount;
+void Loading_reloadAsset(const char* assetpath);
+// jobs run work on a loader thread, then finish on the main thread once
+// all their dependencies are done. outside of loading both run at once
+LoadJobID Loading_addJob(LoadJobFn work, LoadJobFn finish, void* data);
+void Loading_addDependency(LoadJobID self, LoadJobID dependency);
+void Loading_finishJobs(bool wait);
+
+// printed from a background thread between startup and shutdown
+void Log_startup(void);
+void Log_shutdown(void);
+void Log_flush(void);
+void Log_setLevel(LogCategory category, int level);
+const char* Log_getCategoryName(LogCategory category);
+void Log_write(LogLevel level, LogCategory category, const char* format, ...);
 void Log_error(const char* format, ...);
 void Log_warn(const char* format, ...);
 void Log_info(const char* format, ...);
-void Log_debug(const char* format, ...);
+int Log_getIssueCount(void); // errors and warnings so far
+bool Log_limit(LogLimit* limit, int* suppressed);
 
 void LootTable_init(void);
 LootTableID LootTable_find(const char* name);
@@ -475,6 +700,10 @@ void LootTable_drop(LootTableID self, int x, int y);
 extern SDL_Window* Main_window;
 extern SDL_Renderer* Main_renderer;
 void Main_stateChange(MainState nextState);
+MainState Main_getState(void);
+int Main_getTick(void); // fixed updates run so far
+// how far rendering is between the last two ticks, 0 to 1
+float Main_getTickAlpha(void);
 
 int Math_sanitizeAngle(int a);
 int Math_lerp(int a, int b, float f);
@@ -485,6 +714,8 @@ int Math_lengthSquared(int x, int y);
 float Math_clampf(float value, float min, float max);
 void Math_normalizeXY(float* x, float* y);
 
+int Lz_decompress(const uint8_t* src, int srcSize, uint8_t* dst, int dstSize);
+
 void Menu_enter(void);
 void Menu_leave(void);
 void Menu_update(void);
@@ -495,16 +726,48 @@ MusicID Music_find(const char* name);
 void Music_play(MusicID self);
 void Music_stop(void);
 
+int NameIndex_find(NameIndex* self, const char* name);
+int NameIndex_add(NameIndex* self, const char* name);
+void NameIndex_invalidateAll(void);
+
 void NavGrid_set(int width, int height, bool* data);
 int NavGrid_findPath(int fromX, int fromY, int toX, int toY,
     int maxLength, int* pathXs, int* pathYs);
 
+// paces frames to Config_frameRate and keeps frame time stats
+void Pacer_startup(void);
+void Pacer_beginFrame(void);
+void Pacer_addSample(FramePhase phase, uint64_t begin, uint64_t end);
+void Pacer_drawOverlay(BFontID font);
+void Pacer_startCapture(const char* name, int frames);
+bool Pacer_isCapturing(void);
+bool Pacer_writeCsv(const char* path);
+
+void Particles_registerTables(void);
 void Particles_load(void);
 ParticlesID Particles_find(const char* name);
 void Particles_spawn(ParticlesID particles, int x, int y, int z);
 void Particles_update(void);
 void Particles_draw(void);
-
+int Particles_getCount(void);
+
+#ifdef HELMSGARD_PROFILE
+extern int Profile_counters[ProfileCounter_COUNT];
+void Profile_begin(ProfileScope scope);
+void Profile_end(ProfileScope scope);
+void Profile_endFrame(void);
+void Profile_reset(void);
+bool Profile_writeCsv(const char* path); // totals since Profile_reset
+const char* Profile_getScopeName(ProfileScope scope);
+double Profile_getScopeMs(ProfileScope scope); // since Profile_reset
+int Profile_getScopeCalls(ProfileScope scope);
+const char* Profile_getCounterName(ProfileCounter counter);
+int Profile_getCounterTotal(ProfileCounter counter);
+void Profile_cycleSort(void);
+void Profile_drawOverlay(BFontID font);
+#endif
+
+void Quest_registerTables(void);
 void Quest_load(void);
 void Quest_reset(void);
 QuestID Quest_find(const char* name);
@@ -520,6 +783,14 @@ bool Quest_isCompleted(QuestID quest);
 int Quest_getPriority(QuestID quest);
 void Quest_bump(QuestID quest);
 
+void Random_seed(uint64_t seed);
+uint64_t Random_getSeed(void);
+uint32_t Random_next(RandomStream stream);
+int Random_int(RandomStream stream, int n);
+float Random_float(RandomStream stream, float min, float max);
+void Random_fillUnit(RandomStream stream, float* out, int count);
+
+void Recipe_registerTables(void);
 void Recipe_load(void);
 RecipeID Recipe_find(const char* name);
 RecipeID Recipe_next(RecipeID recipe);
@@ -537,22 +808,54 @@ void Region_load(int id);
 void Region_render(int layerID);
 bool Region_isTileSolid(int tx, int ty);
 
+// input recording and playback, see replay.c
+bool Replay_startRecording(const char* path);
+int Replay_startPlayback(const char* path);
+void Replay_begin(void);
+void Replay_end(void);
+void Replay_shutdown(void);
+bool Replay_isRecording(void);
+bool Replay_isPlaying(void);
+bool Replay_isFinished(void);
+int Replay_getMismatchCount(void);
+void Replay_recordInput(const InputFrame* frame);
+bool Replay_playInput(InputFrame* frame);
+void Replay_endTick(void);
+
+// sprite images and sound chunks load on first use and unload once over
+// the asset budget, least recently used first
+bool Residency_use(ResidentKind kind, int id);
+void Residency_prefetch(ResidentKind kind, int id);
+void Residency_evict(ResidentKind kind, int id);
+void Residency_clear(ResidentKind kind);
+void Residency_update(void);
+int Residency_getLoadedBytes(void);
+
 void SDLAssert(bool cond);
 
 void Sound_loadFrom(const char* assetpath);
 SoundID Sound_find(const char* name);
+void Sound_decodeChunk(SoundID self);
+size_t Sound_loadChunk(SoundID self);
+bool Sound_unloadChunk(SoundID self);
+void Sound_prefetch(SoundID self);
 void Sound_play(SoundID self);
 
-// todo: this should probably be local within graphics.c
-void Sprite_setSpriteImage(const char* assetpath, SDL_Texture* texture);
+void Sprite_decodeImage(int image);
+size_t Sprite_loadImage(int image);
+bool Sprite_unloadImage(int image);
+bool Sprite_reloadImage(const char* assetpath);
+void Sprite_registerTables(void);
 void Sprite_loadFrom(const char* assetpath);
 SpriteID Sprite_find(const char* name);
+void Sprite_prefetch(SpriteID self);
 void Sprite_draw(SpriteID self, int x, int y);
 void Sprite_drawScaled(SpriteID self, int x, int y, int w, int h);
 
 void SpriteQueue_clear(void);
 void SpriteQueue_addSprite(SpriteID spriteID, int x, int y, int z);
 void SpriteQueue_addAnim(AnimationID animationID, int x, int y, int z, int* time);
+void SpriteQueue_addBatch(SpriteQueueBatchFn fn, int arg, int y);
 void SpriteQueue_render(void);
 
 void StatusEffect_load(void);
@@ -578,12 +881,32 @@ void Title_leave(void);
 void Title_update(void);
 void Title_render(void);
 
+// zones are begun and ended in pairs on the same thread
+void Trace_startup(const char* path);
+void Trace_shutdown(void);
+void Trace_setThreadName(const char* name); // name must stay valid
+void Trace_begin(const char* name);
+void Trace_end(void);
+
+void Villager_registerTables(void);
 void Villager_load(void);
 VillagerID Villager_find(const char* name);
 const char* Villager_getDialog(VillagerID villagerID);
 const char* Villager_getTitle(VillagerID villagerID);
 
+// asset directory watcher for hot reloading
+void Watch_startup(void);
+void Watch_update(void);
+void Watch_shutdown(void);
+
 Archive Archive_open(const char* path);
 void Archive_close(Archive self);
+Archive Archive_get(const char* path); // shared, stays open
+void Archive_closeAll(void);
+const void* Archive_view(Archive self, const char* name, size_t* size);
+void Archive_unpackAsync(Archive self);
+void Archive_getProgress(int* done, int* total);
 size_t Archive_getSize(Archive self, const char* name);
 size_t Archive_read(Archive self, const char* name, size_t size, void* dst);
+int Archive_getEntryCount(Archive self);
+const void* Archive_viewEntry(Archive self, int index, size_t* size);
@@ -21,33 +21,50 @@ static int _getEnum(const char* section, const char* name,
 // ===== [[ Static Data ]] =====
 
 int Config_displayMode;
+int Config_frameRate;
+bool Config_vsync;
 char Config_assetDirectory[256];
+char Config_assetArchive[256];
+char Config_gameDatabase[256];
 bool Config_muteMusic;
 bool Config_muteSounds;
 bool Config_disableAudio;
+int Config_assetBudget;
 bool Config_showPerf;
 bool Config_showCollision;
 bool Config_showNavGrid;
+bool Config_hotReload;
 float Config_deadzoneX;
 float Config_deadzoneY;
 int Config_logLevel;
+int Config_logLevels[LogCategory_COUNT];
 
 // ===== [[ Implementations ]] =====
 
 void Config_load(void) {
     Ini_readFile("config.ini");
     _getString("Assets", "assetDirectory", Config_assetDirectory, 256);
+    _getString("Assets", "assetArchive", Config_assetArchive, 256);
+    _getString("Assets", "gameDatabase", Config_gameDatabase, 256);
+    Config_assetBudget = _getInt("Assets", "assetBudget", 64);
     Config_displayMode = _getInt("Display", "displayMode", 1);
+    Config_frameRate = _getInt("Display", "frameRate", 0);
+    Config_vsync = _getBoolean("Display", "vsync", true);
     Config_muteMusic = _getBoolean("Audio", "muteMusic", false);
     Config_muteSounds = _getBoolean("Audio", "muteSounds", false);
     Config_disableAudio = _getBoolean("Audio", "disableAudio", false);
     Config_showPerf = _getBoolean("Debug", "showPerf", IS_DEBUG);
     Config_showCollision = _getBoolean("Debug", "showCollision", false);
     Config_showNavGrid = _getBoolean("Debug", "showNavGrid", false);
+    Config_hotReload = _getBoolean("Debug", "hotReload", IS_DEBUG);
     Config_deadzoneX = _getFloat("Input", "deadzoneX", 0.05f);
     Config_deadzoneY = _getFloat("Input", "deadzoneY", 0.05f);
     Config_logLevel = _getEnum("Debug", "logLevel",
             "error;warn;info;debug", 2);
+    for (int i = 0; i < LogCategory_COUNT; i++) {
+        Config_logLevels[i] = _getEnum("Log", Log_getCategoryName(i),
+                "error;warn;info;debug", Config_logLevel);
+    }
     Ini_clear();
 }
 
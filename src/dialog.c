@@ -53,10 +53,19 @@ static DialogTrigger _triggers[MAX_DIALOG_TRIGGERS];
 static DialogConvo _convos[MAX_DIALOG_CONVOS];
 
 static int _triggerCount;
+static NameIndex _triggerIndex = NAME_INDEX(_triggers, _triggerCount);
 static int _convoCount;
+static NameIndex _convoIndex = NAME_INDEX(_convos, _convoCount);
 
 // ===== [[ Implementations ]] =====
 
+void Dialog_registerTables(void) {
+    GameDb_addTable("dialogTriggers", _triggers, sizeof(DialogTrigger),
+            &_triggerCount, MAX_DIALOG_TRIGGERS, NULL);
+    GameDb_addTable("dialogConvos", _convos, sizeof(DialogConvo),
+            &_convoCount, MAX_DIALOG_CONVOS, NULL);
+}
+
 void Dialog_load(void) {
     Ini_readAsset("dlgconvos.ini");
 
@@ -155,18 +164,16 @@ void Dialog_load(void) {
 
 DialogID Dialog_find(const char* name) {
     if (!name) return -1;
-    for (int i = 0; i < _triggerCount; i++) {
-        if (strcmp(_triggers[i].name, name) == 0) return i;
-    }
+    int id = NameIndex_find(&_triggerIndex, name);
+    if (id != -1) return id;
     Log_warn("Cannot find trigger %s", name);
     return -1;
 }
 
 DialogLineID Dialog_findLine(const char* name) {
     if (!name) return -1;
-    for (int i = 0; i < _convoCount; i++) {
-        if (strcmp(_convos[i].name, name) == 0) return i;
-    }
+    int id = NameIndex_find(&_convoIndex, name);
+    if (id != -1) return id;
     Log_warn("Cannot find convo %s", name);
     return -1;
 }
@@ -220,7 +227,7 @@ DialogID Dialog_findCandidate(VillagerID villager) {
     // shuffle
     for (int i = 0; i < nextCandidate; i++) {
         // j is random value in range [0,nextCandidate)
-        int j = i + (rand() % (nextCandidate - i));
+        int j = i + (Random_int(RandomStream_dialog, nextCandidate - i));
         DialogID tmp = candidates[i];
         candidates[i] = candidates[j];
         candidates[j] = tmp;
@@ -314,6 +314,8 @@ static bool _isInvincible(int i);
 static void _playerCollect(int playerID, int collectibleID);
 static int _entDistSq(CLocation* a, CLocation* b);
 static const char* _getDebugName(int i);
+static void _resolveIds(void);
+static void _getDrawPosition(CLocation* loc, int* x, int* y);
 
 //  ecs stuff
 // todo: use proper typedef for entity ids publicly
@@ -346,11 +348,36 @@ Prefab Entity_prefabs[MAX_PREFABS];
 static Attack _attacks[MAX_ATTACKS];
 
 static int _prefabCount;
+static NameIndex _prefabIndex = NAME_INDEX(Entity_prefabs, _prefabCount);
 static int _attackCount;
+static NameIndex _attackIndex = NAME_INDEX(_attacks, _attackCount);
 static int _playerInteractionPartner;
+static int _updatedTick; // tick Entity_updateAll last ran on
 
 static StatusEffect _statusEffects[MAX_STATUS_EFFECTS];
 static int _statusEffectCount;
+static NameIndex _statusEffectIndex = NAME_INDEX(_statusEffects, _statusEffectCount);
+
+// assets used every frame, looked up once when the first entity spawns
+static struct {
+    bool resolved;
+    AnimationID bossIdle;
+    AnimationID bossStun;
+    int bossSpawn;
+    int slime;
+    SoundID crit;
+    SoundID hit;
+    ParticlesID ptCrit;
+    ParticlesID ptDirtRoll;
+    SpriteID intrTalk;
+    SpriteID intrItem;
+    SpriteID qmWhite;
+    SpriteID qmGreen;
+    SpriteID qmGray;
+    SpriteID bhpFrame[3];
+    SpriteID bhpFill[3];
+    SpriteID bhpTitle;
+} _ids;
 
 // ecs stuff
 typedef struct {
@@ -414,7 +441,18 @@ static EcsComponent CBoss_id;
 
 // ===== [[ Implementations ]] =====
 
-void Entity_loadPrefabsFrom(const char* assetpath) {
+void Entity_registerTables(void) {
+    GameDb_addTable("prefabs", Entity_prefabs, sizeof(Prefab),
+            &_prefabCount, MAX_PREFABS, NULL);
+    GameDb_addTable("attacks", _attacks, sizeof(Attack),
+            &_attackCount, MAX_ATTACKS, NULL);
+    GameDb_addTable("statusEffects", _statusEffects, sizeof(StatusEffect),
+            &_statusEffectCount, MAX_STATUS_EFFECTS, NULL);
+}
+
+// Component pools, once at startup. Prefab loading may run again on a
+// reload or not at all with the game database, so this isn't part of it
+void Entity_init(void) {
 //    _ecsTest();
     CLaunch_id = _componentRegister(sizeof(CLaunch));
     CMotion_id = _componentRegister(sizeof(CMotion));
@@ -446,7 +484,9 @@ void Entity_loadPrefabsFrom(const char* assetpath) {
     CHint_id = _componentRegister(sizeof(CHint));
     CBoss_id = _componentRegister(sizeof(CBoss));
     // todo: make 0 invalid component id so i detect forgetting this bit
+}
 
+void Entity_loadPrefabsFrom(const char* assetpath) {
     Ini_readAsset(assetpath);
 
     for (int i = 0; Ini_getSectionName(i); i++) {
@@ -458,7 +498,7 @@ void Entity_loadPrefabsFrom(const char* assetpath) {
             return;
         }
 
-        Prefab* prefab = &Entity_prefabs[_prefabCount++];
+        Prefab* prefab = &Entity_prefabs[NameIndex_add(&_prefabIndex, name)];
         memset(prefab, 0, sizeof(Prefab));
         strncpy(prefab->name, name, NAME_LENGTH);
         
@@ -552,7 +592,7 @@ void Attack_loadFrom(const char* assetpath) {
             return;
         }
 
-        Attack* attack = &_attacks[_attackCount++];
+        Attack* attack = &_attacks[NameIndex_add(&_attackIndex, name)];
         strncpy(attack->name, name, NAME_LENGTH);
         
         attack->duration = String_parseInt(Ini_get(name, "duration"), 24);
@@ -576,9 +616,8 @@ void Attack_loadFrom(const char* assetpath) {
 
 int Attack_find(const char* name) {
     if (!name) return -1;
-    for (int i = 0; i < _attackCount; i++) {
-        if (strcmp(_attacks[i].name, name) == 0) return i;
-    }
+    int id = NameIndex_find(&_attackIndex, name);
+    if (id != -1) return id;
     Log_warn("Cannot find attack %s", name);
     return -1;
 }
@@ -591,8 +630,23 @@ void Entity_updateAll(void) {
         _ecsNextQuery = 0;
     }
 
+    // remember where everything was, rendering interpolates from there
+    _updatedTick = Main_getTick();
+    {
+    PROFILE_BEGIN(storeLocations);
+    QUERY_COMPONENT(CLocation, loc);
+    _queryBegin();
+    while (_queryNext()) {
+        loc->prevx = loc->x;
+        loc->prevy = loc->y;
+    }
+    _queryEnd();
+    PROFILE_END(storeLocations);
+    }
+
     // UpdatePlayerControllers()
     {
+    PROFILE_BEGIN(updatePlayerControllers);
     QUERY_ID(i);
     QUERY_COMPONENT(CLocation, loc);
     // todo: use a more generic 'ItemCollector' tag or something?
@@ -619,10 +673,12 @@ void Entity_updateAll(void) {
         _playerUpdate(i);
     }
     _queryEnd();
+    PROFILE_END(updatePlayerControllers);
     }
 
     // UpdateEnemyControllers()
     {
+    PROFILE_BEGIN(updateEnemyControllers);
     QUERY_ID(i);
     QUERY_COMPONENT(CEnemyController, cec);
     _queryBegin();
@@ -630,11 +686,13 @@ void Entity_updateAll(void) {
         _enemyUpdate(i);
     }
     _queryEnd();
+    PROFILE_END(updateEnemyControllers);
     }
 
     // follow pathfinding
     // todo: currently gets stuck on NW edges heading SW
     {
+    PROFILE_BEGIN(followPaths);
     QUERY_ID(i);
     QUERY_COMPONENT(CLocation, location);
     QUERY_COMPONENT(CPathfinding, pathfinding);
@@ -667,10 +725,12 @@ void Entity_updateAll(void) {
         }
     }
     _queryEnd();
+    PROFILE_END(followPaths);
     }
 
     // UpdateBoss()
     {
+    PROFILE_BEGIN(updateBoss);
     QUERY_ID(i);
     QUERY_COMPONENT(CBoss, boss);
     QUERY_COMPONENT(CLocation, loc);
@@ -684,16 +744,16 @@ void Entity_updateAll(void) {
         int player = Entity_getPlayer();
         if (player == -1) continue;
         CLocation* player_loc = _componentGet(player, CLocation_id);
-        AnimationID anm_idle = Animation_find("boss_idle2");
-        AnimationID anm_stun = Animation_find("boss_idle");
+        AnimationID anm_idle = _ids.bossIdle;
+        AnimationID anm_stun = _ids.bossStun;
         if (!boss->active) {
             if (_entDistSq(loc, player_loc) < 1500*1500) {
-                Log_debug("ACTIVATE");
+                LOG_DEBUG(entity, "ACTIVATE");
                 boss->active = true;
             } else continue;
         } else {
             if (_entDistSq(loc, player_loc) > 3000*3000) {
-                Log_debug("DEACTIV");
+                LOG_DEBUG(entity, "DEACTIV");
                 boss->active = false; continue;
             }
         }
@@ -711,10 +771,9 @@ void Entity_updateAll(void) {
             boss->stun_tents = 0;
             // SPAWN TENTACLES
             if (boss->timer == 10) for (int i = 0; i < 3; i++) {
-                int x = loc->x + rand() % 1000 - 500;
-                int y = loc->y + 200 + rand() % 1000;
-                int prefab = Entity_findPrefab("boss_spawn");
-                Entity_spawn(x, y, prefab);
+                int x = loc->x + Random_int(RandomStream_ai, 1000) - 500;
+                int y = loc->y + 200 + Random_int(RandomStream_ai, 1000);
+                Entity_spawn(x, y, _ids.bossSpawn);
             }
             if (boss->timer > 100) {
                 boss->phase = false;
@@ -731,10 +790,9 @@ void Entity_updateAll(void) {
             if (actor && actor->hp < 50) amount++;
             if (actor && actor->hp < 25) amount++;
             if (boss->timer < 10*amount && boss->timer % 10 == 9) {
-                int x = loc->x + rand() % 1000 - 500;
-                int y = loc->y + 200 + rand() % 1000;
-                int prefab = Entity_findPrefab("slime");
-                Entity_spawn(x, y, prefab);
+                int x = loc->x + Random_int(RandomStream_ai, 1000) - 500;
+                int y = loc->y + 200 + Random_int(RandomStream_ai, 1000);
+                Entity_spawn(x, y, _ids.slime);
             }
             if (boss->timer > 200) {
                 boss->phase = true;
@@ -743,10 +801,12 @@ void Entity_updateAll(void) {
         }
     }
     _queryEnd();
+    PROFILE_END(updateBoss);
     }
 
     // UpdateIntent()
     {
+    PROFILE_BEGIN(updateIntent);
     QUERY_ID(i);
     QUERY_COMPONENT(CIntent, intent);
     QUERY_COMPONENT(CActor, actor);
@@ -795,20 +855,20 @@ void Entity_updateAll(void) {
                 if (other_ci) {
                     if (other_ci->type == InteractionType_debug) {
                         const char* name = _getDebugName(other);
-                        Log_debug("interact with %s", name);
+                        LOG_DEBUG(entity, "interact with %s", name);
                     } else if (other_ci->type == InteractionType_talk) {
                         Game_setDialog(other);
                     } else if (other_ci->type == InteractionType_craft) {
                         Game_setCrafting();
                     } else if (other_ci->type == InteractionType_chest) {
-                        Log_debug("CHEST CONTENT:");
+                        LOG_DEBUG(entity, "CHEST CONTENT:");
                         CMiniInventory* inv = _componentGet(
                             other, CMiniInventory_id
                         );
                         if (inv) {
                             for (int i = 0; i < 16; i++) {
                                 if (inv->items[i] != -1) {
-                                    Log_debug("  - %s (%dx)",
+                                    LOG_DEBUG(entity, "  - %s (%dx)",
                                         Item_getDisplayName(inv->items[i]),
                                         inv->quantity[i]);
                                 }
@@ -869,10 +929,12 @@ void Entity_updateAll(void) {
 
     }
     _queryEnd();
+    PROFILE_END(updateIntent);
     }
 
     // UpdateAttack()
     {
+    PROFILE_BEGIN(updateAttack);
     QUERY_ID(i);
     QUERY_COMPONENT(CStateAttack, csa);
     QUERY_COMPONENT(CActor, entActor);
@@ -944,7 +1006,7 @@ void Entity_updateAll(void) {
                             Sound_play(misc->soundDie);
                             Particles_spawn(misc->particlesDie,
                                 otherLoc->x, otherLoc->y, 4);
-                            Entity_dropGold(otherLoc->x, otherLoc->y, rand()%3);
+                            Entity_dropGold(otherLoc->x, otherLoc->y, Random_int(RandomStream_loot, 3));
                         }
                         CMiniInventory* inv = _componentGet(j, CMiniInventory_id);
                         if (inv && inv->dropInvOnDestroy) {
@@ -970,12 +1032,10 @@ void Entity_updateAll(void) {
                     // lck 0: 0% chance crit
                     // lck 10: 25% chance crit
                     int critChance = (lck * 25) / 10;
-                    if (rand() % 100 < critChance) {
+                    if (Random_int(RandomStream_combat, 100) < critChance) {
                         dmg *= 2;
-                        SoundID snd_crit = Sound_find("crit");
-                        Sound_play(snd_crit);
-                        ParticlesID pt_crit = Particles_find("pt_crit");
-                        Particles_spawn(pt_crit,
+                        Sound_play(_ids.crit);
+                        Particles_spawn(_ids.ptCrit,
                             otherLoc->x, otherLoc->y, 4);
                     }
                     if (dmg <= 0) continue;
@@ -992,11 +1052,11 @@ void Entity_updateAll(void) {
                             if (!misc->tentacle && !boss)
                                 Quest_signalEvent(QuestEvent_defeat, j);
                             else if (boss) {
-                                Log_debug("BOSS DEFEAT");
+                                LOG_DEBUG(entity, "BOSS DEFEAT");
                                 Quest_signalEvent(QuestEvent_defeatBoss, j);
                             }
                             if (!misc->tentacle)
-                                Entity_dropGold(otherLoc->x, otherLoc->y, 1 + rand() % 5);
+                                Entity_dropGold(otherLoc->x, otherLoc->y, 1 + Random_int(RandomStream_loot, 5));
                             else {
                                 QUERY_ID(i);
                                 QUERY_COMPONENT(CBoss, boss);
@@ -1042,12 +1102,12 @@ void Entity_updateAll(void) {
                             while (entActor->xp > 50) {
                                 entActor->lvl++;
                                 entActor->xp -= 50;
-                                Log_debug("LEvel up! Now %d", entActor->lvl);
+                                LOG_DEBUG(entity, "LEvel up! Now %d",
+                                        entActor->lvl);
                             }
                         }
                     } else {
-                        SoundID snd_hit = Sound_find("hit1");
-                        Sound_play(snd_hit);
+                        Sound_play(_ids.hit);
                         CLaunch* cl = _componentAttach(j, CLaunch_id);
                         cl->launch = attack->knockback;
                         cl->launchAngle = angleTo;
@@ -1071,10 +1131,12 @@ void Entity_updateAll(void) {
         }
     }
     _queryEnd();
+    PROFILE_END(updateAttack);
     }
 
     // UpdateHurt()
     {
+    PROFILE_BEGIN(updateHurt);
     QUERY_ID(i);
     QUERY_COMPONENT(CStateHurt, csh);
     _queryBegin();
@@ -1090,10 +1152,12 @@ void Entity_updateAll(void) {
         }
     }
     _queryEnd();
+    PROFILE_END(updateHurt);
     }
 
     // UpdateRolling()
     {
+    PROFILE_BEGIN(updateRolling);
     QUERY_ID(i);
     QUERY_COMPONENT(CStateRolling, csr);
     _queryBegin();
@@ -1106,10 +1170,12 @@ void Entity_updateAll(void) {
         }
     }
     _queryEnd();
+    PROFILE_END(updateRolling);
     }
 
     // UpdateAlert()
     {
+    PROFILE_BEGIN(updateAlert);
     QUERY_ID(i);
     QUERY_COMPONENT(CStateAlert, csa);
     _queryBegin();
@@ -1122,10 +1188,12 @@ void Entity_updateAll(void) {
         }
     }
     _queryEnd();
+    PROFILE_END(updateAlert);
     }
 
     // UpdateStatusEffects()
     {
+    PROFILE_BEGIN(updateStatusEffects);
     QUERY_COMPONENT(CStatusEffects, cse);
     _queryBegin();
     while (_queryNext()) {
@@ -1136,10 +1204,12 @@ void Entity_updateAll(void) {
         }
     }
     _queryEnd();
+    PROFILE_END(updateStatusEffects);
     }
 
     // UpdateBeingCollected()
     {
+    PROFILE_BEGIN(updateBeingCollected);
     QUERY_ID(i);
     QUERY_COMPONENT(CBeingCollected, cbc);
     QUERY_COMPONENT(CLocation, loc);
@@ -1183,10 +1253,12 @@ void Entity_updateAll(void) {
         }
     }
     _queryEnd();
+    PROFILE_END(updateBeingCollected);
     }
 
     // UpdateShake
     {
+    PROFILE_BEGIN(updateShake);
     QUERY_ID(i);
     QUERY_COMPONENT(CShake, shake);
     QUERY_COMPONENT(CSprite, sprite);
@@ -1205,10 +1277,12 @@ void Entity_updateAll(void) {
         }
     }
     _queryEnd();
+    PROFILE_END(updateShake);
     }
 
     // Play_UpdateLaunch()? FJ_UpdateLaunch()?
     {
+    PROFILE_BEGIN(updateLaunch);
     QUERY_ID(i);
     QUERY_COMPONENT(CLaunch, cl);
     _queryBegin();
@@ -1226,10 +1300,12 @@ void Entity_updateAll(void) {
         }
     }
     _queryEnd();
+    PROFILE_END(updateLaunch);
     }
 
     // UpdateHint()
     {
+    PROFILE_BEGIN(updateHint);
     int player = Entity_getPlayer();
     if (player == -1) goto skip_hint;
     CLocation* player_loc = _componentGet(player, CLocation_id);
@@ -1248,26 +1324,28 @@ void Entity_updateAll(void) {
     Game_setHintText(nearestText);
     _queryEnd();
     skip_hint:;
+    PROFILE_END(updateHint);
     }
 
     // entity motion
     {
+    PROFILE_BEGIN(entityMotion);
     QUERY_ID(i);
     QUERY_COMPONENT(CLocation, loc);
     QUERY_COMPONENT(CMotion, cm);
     _queryBegin();
     while (_queryNext()) {
-        loc->prevx = loc->x;
-        loc->prevy = loc->y;
         loc->x += cm->movex;
         loc->y += cm->movey;
         _componentDetach(i, CMotion_id);
     }
     _queryEnd();
+    PROFILE_END(entityMotion);
     }
 
     // resolve entity intersections
     {
+    PROFILE_BEGIN(entityIntersections);
     QUERY_ID(i);
     QUERY_COMPONENT(CSolid, entSolid);
     QUERY_COMPONENT(CLocation, entLoc);
@@ -1319,10 +1397,12 @@ void Entity_updateAll(void) {
         _queryEnd();
     }
     _queryEnd();
+    PROFILE_END(entityIntersections);
     }
 
     // resolve entity-field intersections
     {
+    PROFILE_BEGIN(fieldIntersections);
     QUERY_ID(i);
     QUERY_COMPONENT(CSolid, solid);
     QUERY_COMPONENT(CLocation, loc);
@@ -1345,10 +1425,41 @@ void Entity_updateAll(void) {
         }
     }
     _queryEnd();
+    PROFILE_END(fieldIntersections);
+    }
+}
+
+// Advance animation and bob timers, render only reads them
+void Entity_updateAnimations(bool advance) {
+    {
+    QUERY_COMPONENT(CAnimation, ca);
+    _queryBegin();
+    while (_queryNext()) {
+        // reset anim timer when entering a new state
+        if (ca->animState != ca->prevAnimState) {
+            ca->prevAnimState = ca->animState;
+            ca->time = 0;
+        } else if (advance) {
+            ca->time++;
+        }
+    }
+    _queryEnd();
+    }
+
+    if (!advance) return;
+
+    {
+    QUERY_COMPONENT(CSprite, cs);
+    _queryBegin();
+    while (_queryNext()) {
+        if (cs->spriteBob > 0) cs->bobTimer++;
+    }
+    _queryEnd();
     }
 }
 
 void Entity_renderAll(void) {
+    PROFILE_BEGIN(renderAnimations);
     QUERY_ID(i);
     QUERY_COMPONENT(CLocation, loc);
     QUERY_COMPONENT(CAnimation, ca);
@@ -1362,24 +1473,21 @@ void Entity_renderAll(void) {
             if (solid) Draw_circle(loc->x/16, loc->y/16, solid->radius/16);
         }
 
-        // reset anim timer when entering a new state
-        if (ca->animState != ca->prevAnimState) {
-            ca->prevAnimState = ca->animState;
-            ca->time = 0;
-        }
-
         // play/draw animation
         AnimationID anim = Entity_getCurrentAnim(i);
         if (anim != -1) {
+            int x, y;
+            _getDrawPosition(loc, &x, &y);
             if (interactee) Graphics_setModulationColor(255, 0, 0);
-            SpriteQueue_addAnim(anim, loc->x/16, loc->y/16,
-                    loc->zoff, &ca->time);
+            SpriteQueue_addAnim(anim, x, y, loc->zoff, &ca->time);
             if (interactee) Graphics_clearModulationColor();
         }
     }
     _queryEnd();
+    PROFILE_END(renderAnimations);
 
     {
+    PROFILE_BEGIN(renderSprites);
     QUERY_ID(i);
     QUERY_COMPONENT(CLocation, loc);
     QUERY_COMPONENT(CSprite, cs);
@@ -1391,18 +1499,21 @@ void Entity_renderAll(void) {
 
         int z = cs->spritez + loc->zoff;
         if (cs->spriteBob > 0) {
-            float bobTime = cs->bobTimer++ / (float) cs->bobDuration;
+            float bobTime = cs->bobTimer / (float) cs->bobDuration;
             z += Math_sin(bobTime * 360.f) * cs->spriteBob;
         }
+        int x, y;
+        _getDrawPosition(loc, &x, &y);
         if (interactee) Graphics_setModulationColor(255, 0, 0);
-        SpriteQueue_addSprite(cs->sprite,
-                loc->x/16 + cs->spritex,
-                loc->y/16 + cs->spritey, z);
+        SpriteQueue_addSprite(cs->sprite, x + cs->spritex, y + cs->spritey, z);
         if (interactee) Graphics_clearModulationColor();
     }
     _queryEnd();
+    PROFILE_END(renderSprites);
     }
 
+    // interaction and quest markers
+    PROFILE_BEGIN(renderMarkers);
     {
     QUERY_ID(i);
     QUERY_COMPONENT(CInteraction, intr);
@@ -1413,16 +1524,18 @@ void Entity_renderAll(void) {
         SpriteID spr = -1;
         if (intr->type == InteractionType_talk ||
             intr->type == InteractionType_shop) {
-            spr = Sprite_find("ui/intrTalk");
+            spr = _ids.intrTalk;
         } else if (intr->type == InteractionType_chest) {
-            spr = Sprite_find("ui/intrItem");
+            spr = _ids.intrItem;
         }
         int player = Entity_getPlayer();
         if (player == -1) continue;
         CLocation* loc = _componentGet(player, CLocation_id);
         if (loc == NULL) continue;
         if (spr != -1) {
-            SpriteQueue_addSprite(spr, loc->x/16, loc->y/16+1, 17);
+            int x, y;
+            _getDrawPosition(loc, &x, &y);
+            SpriteQueue_addSprite(spr, x, y+1, 17);
         }
     }
     _queryEnd();
@@ -1438,18 +1551,21 @@ void Entity_renderAll(void) {
         int iconId = Dialog_getDisplayIcon(nextDlg);
         SpriteID spr = -1;
         if (iconId == 1) {
-            spr = Sprite_find("ui/qmwhite");
+            spr = _ids.qmWhite;
         } else if (iconId == 2) {
-            spr = Sprite_find("ui/qmgreen");
+            spr = _ids.qmGreen;
         } else if (iconId == 3) {
-            spr = Sprite_find("ui/qmgray");
+            spr = _ids.qmGray;
         };
         if (spr != -1) {
-            SpriteQueue_addSprite(spr, loc->x/16, loc->y/16+1, 17);
+            int x, y;
+            _getDrawPosition(loc, &x, &y);
+            SpriteQueue_addSprite(spr, x, y+1, 17);
         }
     }
     _queryEnd();
     }
+    PROFILE_END(renderMarkers);
 
     if (Config_showCollision) {
         Field_drawDebug();
@@ -1507,6 +1623,7 @@ void Entity_renderAll(void) {
 
 int Entity_spawn(int x, int y, int prefabID) {
     if (prefabID < 0 || prefabID > _prefabCount) return 0;
+    _resolveIds();
     // int id = 0;
     // while (id < MAX_ENTITIES && Entity_table[id].valid) id++;
     // if (id == MAX_ENTITIES) {
@@ -1614,6 +1731,21 @@ int Entity_spawn(int x, int y, int prefabID) {
     return id;
 }
 
+// Scatter count copies of a prefab up to radius tiles from x, y. Returns
+// how many were spawned before running out of entities.
+int Entity_spawnAround(int prefabID, int x, int y, int count, int radius) {
+    Entity_prefetchPrefab(prefabID);
+    int spawned = 0;
+    for (int i = 0; i < count; i++) {
+        float angle = Random_float(RandomStream_ai, 0, 360);
+        float distance = Random_float(RandomStream_ai, 0, radius * 16);
+        if (!Entity_spawn(x + Math_cos(angle) * distance,
+                y + Math_sin(angle) * distance, prefabID)) break;
+        spawned++;
+    }
+    return spawned;
+}
+
 void Entity_destroy(int id) {
     _entityDestroy(id);
 }
@@ -1630,6 +1762,23 @@ void Entity_destroyAll(void) {
     }
 }
 
+// Everything but one entity, e.g. all a region spawned but the player
+void Entity_destroyAllBut(int keep) {
+    for (int i = 0; i < ECS_MAX_ENTITIES; i++) {
+        EcsEntity e = (_ecsEntityGeneration[i] << 16) | i;
+        if (e != keep && _entityValid(e)) _entityDestroy(e);
+    }
+}
+
+// Players other than this one, e.g. one a reloaded region spawned again
+void Entity_destroyPlayersBut(int keep) {
+    for (int i = 0; i < ECS_MAX_ENTITIES; i++) {
+        EcsEntity e = (_ecsEntityGeneration[i] << 16) | i;
+        if (e == keep || !_entityValid(e)) continue;
+        if (_componentGet(e, CPlayerController_id)) _entityDestroy(e);
+    }
+}
+
 int Entity_getPlayer(void) {
     QUERY_ID(i);
     QUERY_COMPONENT(CPlayerController, cpc);
@@ -1642,11 +1791,53 @@ int Entity_getPlayer(void) {
     return -1;
 }
 
+int Entity_getCount(void) {
+    int count = 0;
+    for (int i = 0; i < ECS_MAX_ENTITIES; i++) {
+        if (_ecsEntityValid[i]) count++;
+    }
+    return count;
+}
+
+// Load what a prefab draws and plays ahead of its first spawn
+void Entity_prefetchPrefab(int prefabID) {
+    if (prefabID < 0 || prefabID >= _prefabCount) return;
+    Prefab* prefab = &Entity_prefabs[prefabID];
+    Sprite_prefetch(prefab->sprite);
+    Sprite_prefetch(prefab->harvestedSprite);
+    Animation_prefetch(prefab->animIdle);
+    for (int i = 0; i < 4; i++) {
+        Animation_prefetch(prefab->animWalk[i]);
+        Animation_prefetch(prefab->animAttack[i]);
+        Animation_prefetch(prefab->animHurt[i]);
+        Animation_prefetch(prefab->animRoll[i]);
+        Animation_prefetch(prefab->animAlert[i]);
+    }
+    Sound_prefetch(prefab->soundDie);
+}
+
+// FNV-1a over every live component, for checking replays tick by tick
+uint32_t Entity_getChecksum(void) {
+    uint32_t hash = 2166136261u;
+    for (int c = 0; c < _ecsNextComponent; c++) {
+        ComponentData* component = &_ecsComponents[c];
+        for (int i = 0; i < ECS_MAX_ENTITIES; i++) {
+            if (!component->valid[i]) continue;
+            const unsigned char* data =
+                &((unsigned char*) component->pool)[i * component->width];
+            hash = (hash ^ (unsigned) i) * 16777619u;
+            for (int j = 0; j < component->width; j++) {
+                hash = (hash ^ data[j]) * 16777619u;
+            }
+        }
+    }
+    return hash;
+}
+
 int Entity_findPrefab(const char* name) {
     if (!name) return -1;
-    for (int i = 0; i < _prefabCount; i++) {
-        if (strcmp(Entity_prefabs[i].name, name) == 0) return i;
-    }
+    int id = NameIndex_find(&_prefabIndex, name);
+    if (id != -1) return id;
     Log_warn("Cannot find prefab %s", name);
     return -1;
 }
@@ -1948,14 +2139,8 @@ void Entity_drawBossHP(void) {
     _queryBegin();
     while (_queryNext()) {
         if (!boss->active) continue;
-        SpriteID spr_frame[3];
-        spr_frame[0] = Sprite_find("ui/bhp_frame_cap");
-        spr_frame[1] = Sprite_find("ui/bhp_frame_mid");
-        spr_frame[2] = Sprite_find("ui/bhp_frame_capr");
-        SpriteID spr_fill[3];
-        spr_fill[0] = Sprite_find("ui/bhp_fill_cap");
-        spr_fill[1] = Sprite_find("ui/bhp_fill_mid");
-        spr_fill[2] = Sprite_find("ui/bhp_fill_capr");
+        SpriteID* spr_frame = _ids.bhpFrame;
+        SpriteID* spr_fill = _ids.bhpFill;
         int x = 0, y = 0;
         int width = actor->hp * 92 / 100;
         x = SCREEN_WIDTH/2 - 96/2;
@@ -1970,7 +2155,7 @@ void Entity_drawBossHP(void) {
         // some kind of frame for The Slime King text also?
         // BFont_drawTextExt(BFont_find("dialog"), SCREEN_WIDTH/2-50,8,100,0.5f,
         //     "Slime King");
-        Sprite_draw(Sprite_find("ui/bhp_title"), x + 19, y - 11);
+        Sprite_draw(_ids.bhpTitle, x + 19, y - 11);
     }
     _queryEnd();
 }
@@ -1987,7 +2172,8 @@ void StatusEffect_load(void) {
             return;
         }
 
-        StatusEffect* statusEffect = &_statusEffects[_statusEffectCount++];
+        StatusEffect* statusEffect =
+                &_statusEffects[NameIndex_add(&_statusEffectIndex, name)];
         strncpy(statusEffect->name, name, NAME_LENGTH);
 
         // todo: handle different types
@@ -2003,9 +2189,8 @@ void StatusEffect_load(void) {
 
 StatusEffectID StatusEffect_find(const char* name) {
     if (!name) return -1;
-    for (int i = 0; i < _statusEffectCount; i++) {
-        if (strcmp(_statusEffects[i].name, name) == 0) return i;
-    }
+    int id = NameIndex_find(&_statusEffectIndex, name);
+    if (id != -1) return id;
     Log_warn("Cannot find status effect %s", name);
     return -1;
 }
@@ -2160,7 +2345,7 @@ static void* _changeState(int i, EntityState newState) {
 
         // todo: find better place for this?
         CLocation* location = _componentGet(i, CLocation_id);
-        Particles_spawn(Particles_find("pt_dirtRoll"),
+        Particles_spawn(_ids.ptDirtRoll,
             location->x, location->y, 2);
     } else if (newState == EntityState_alert) {
         Entity_setAnimState(i, AnimState_alert);
@@ -2173,6 +2358,15 @@ static void* _changeState(int i, EntityState newState) {
     return component;
 }
 
+// Pixel position between the last tick's and this one's, so movement
+// stays smooth when frames and ticks don't line up
+static void _getDrawPosition(CLocation* loc, int* x, int* y) {
+    // nothing moved on the last tick (paused, hitstop)
+    float alpha = _updatedTick == Main_getTick() ? Main_getTickAlpha() : 1;
+    *x = (loc->prevx + (int) ((loc->x - loc->prevx) * alpha)) / 16;
+    *y = (loc->prevy + (int) ((loc->y - loc->prevy) * alpha)) / 16;
+}
+
 static int _findInteractionPartner(int entityID) {
     CLocation* loc = _componentGet(entityID, CLocation_id);
     if (!loc) return -1;
@@ -2220,11 +2414,40 @@ static const char* _getDebugName(int i) {
     return debugLabel ? debugLabel->name : "<unnamed>";
 }
 
+static void _resolveIds(void) {
+    if (_ids.resolved) return;
+    _ids.resolved = true;
+    _ids.bossIdle = Animation_find("boss_idle2");
+    _ids.bossStun = Animation_find("boss_idle");
+    _ids.bossSpawn = Entity_findPrefab("boss_spawn");
+    _ids.slime = Entity_findPrefab("slime");
+    _ids.crit = Sound_find("crit");
+    _ids.hit = Sound_find("hit1");
+    _ids.ptCrit = Particles_find("pt_crit");
+    _ids.ptDirtRoll = Particles_find("pt_dirtRoll");
+    _ids.intrTalk = Sprite_find("ui/intrTalk");
+    _ids.intrItem = Sprite_find("ui/intrItem");
+    _ids.qmWhite = Sprite_find("ui/qmwhite");
+    _ids.qmGreen = Sprite_find("ui/qmgreen");
+    _ids.qmGray = Sprite_find("ui/qmgray");
+    _ids.bhpFrame[0] = Sprite_find("ui/bhp_frame_cap");
+    _ids.bhpFrame[1] = Sprite_find("ui/bhp_frame_mid");
+    _ids.bhpFrame[2] = Sprite_find("ui/bhp_frame_capr");
+    _ids.bhpFill[0] = Sprite_find("ui/bhp_fill_cap");
+    _ids.bhpFill[1] = Sprite_find("ui/bhp_fill_mid");
+    _ids.bhpFill[2] = Sprite_find("ui/bhp_fill_capr");
+    _ids.bhpTitle = Sprite_find("ui/bhp_title");
+}
+
 //  ecs stuff
 typedef int EcsComponent;
 typedef int EcsEntity;
 static EcsComponent _componentRegister(int width) {
-    // todo: check array limit
+    if (_ecsNextComponent == ECS_MAX_COMPONENTS) {
+        Log_error("max components exceeded");
+        Log_flush();
+        abort();
+    }
     EcsComponent id = _ecsNextComponent++;
     ComponentData* component = &_ecsComponents[id];
 
@@ -2320,6 +2543,7 @@ static void _queryAddColumn(EcsComponent c, void** s) {
     QueryData* query = &_ecsQueries[_ecsNextQuery];
     if (query->columnCount >= 4) {
         Log_error("max columns exceeded");
+        Log_flush();
         abort();
     }
     // todo: check colymnCount
@@ -2375,6 +2599,7 @@ static void _queryBegin(void) {
             }
         }
     }
+    PROFILE_COUNT(queryRows, query->rowCount);
 }
 
 static bool _queryNext(void) {
@@ -2416,15 +2641,15 @@ static void _ecsTest(void) {
     // todo: test zero width component also? maybe make c1 zero width?
 
     EcsEntity e1 = _entityCreate();
-    Log_debug("e1 = %08x", e1);
+    LOG_DEBUG(entity, "e1 = %08x", e1);
     assert(_entityValid(e1));
     EcsEntity e2 = _entityCreate();
-    Log_debug("e2 = %08x", e2);
+    LOG_DEBUG(entity, "e2 = %08x", e2);
     assert(_entityValid(e2));
     _entityDestroy(e1);
     assert(!_entityValid(e1));
     EcsEntity e3 = _entityCreate();
-    Log_debug("e3 = %08x", e3);
+    LOG_DEBUG(entity, "e3 = %08x", e3);
     assert(_entityValid(e3));
     assert(!_entityValid(e1));
 
@@ -2463,7 +2688,7 @@ static void _ecsTest(void) {
     assert(((struct V2*)_componentGet(e3, c2))->y == 24);
 
     struct V2* e2_c2 = _componentAttach(e2, c2);
-    Log_debug("%08x -- %08x", e3_c2, e2_c2);
+    LOG_DEBUG(entity, "%08x -- %08x", e3_c2, e2_c2);
     assert(e2_c2);
     assert(e2_c2 != e3_c2);
     *e2_c2 = (struct V2) { 13, 25 };
@@ -2481,7 +2706,7 @@ static void _ecsTest(void) {
     _queryBegin();
     int counter = 0;
     while (_queryNext()) {
-        Log_debug("q0[%d] (ent %08x) { %d, %d }", counter++,
+        LOG_DEBUG(entity, "q0[%d] (ent %08x) { %d, %d }", counter++,
             ent, p_c2->x, p_c2->y);
     }
     _queryEnd();
@@ -2492,7 +2717,7 @@ static void _ecsTest(void) {
     _queryBegin();
     counter = 0;
     while (_queryNext()) {
-        Log_debug("q1[%d] (c1 %d) { %d, %d }", counter++,
+        LOG_DEBUG(entity, "q1[%d] (c1 %d) { %d, %d }", counter++,
             *p_c1, p_c2->x, p_c2->y);
     }
     _queryEnd();
@@ -2514,10 +2739,10 @@ static void _ecsTest(void) {
 }
 
 void _ecsDump(EcsEntity e) {
-    Log_debug("Entity %d (id %d, gen %d)", e, e&0xffff, e>>16);
+    LOG_DEBUG(entity, "Entity %d (id %d, gen %d)", e, e&0xffff, e>>16);
     for (int i = 0; i < _ecsNextComponent; i++) {
         if (_componentGet(e, i)) {
-            Log_debug("  has component %d", i);
+            LOG_DEBUG(entity, "  has component %d", i);
         }
     }
 }
@@ -107,6 +107,7 @@ void Field_addPolygon(int count, FieldPoint* points, bool ccw) {
 }
 
 FieldNearest Field_findNearest(int x, int y) {
+    PROFILE_COUNT(findNearest, 1);
     int nearestX = 0, nearestY = 0;
     int nearestNormal = 0;
     int nearestDistSq = INT32_MAX;
@@ -41,6 +41,7 @@ static void _renderConsole(void);
 static void _renderPause(void);
 static void _renderInventory(void);
 static void _renderDialog(void);
+static const char* _getDialogText(void);
 static void _renderCrafting(void);
 static void _renderChest(void);
 static void _renderGameOver(void);
@@ -53,6 +54,7 @@ static void _renderWorld(void);
 static void _renderHud(void);
 
 static void _drawNinepatch(int x, int y, int w, int h);
+static void _resolveIds(void);
 static int _questCompare(const void* a, const void* b);
 
 // ===== [[ Static Data ]] =====
@@ -60,6 +62,8 @@ static int _questCompare(const void* a, const void* b);
 static GameSubstate _substate;
 static int _sel;
 static int _camx, _camy;
+static int _prevCamx, _prevCamy; // as of the tick before, for interpolation
+static int _camTick; // tick the camera last moved on
 static bool _camsnap;
 static int _dialogPartner;
 static DialogLineID _dialogLine;
@@ -80,9 +84,31 @@ static int _hintTextTimer;
 static int _gold = 20;
 static int _shopQtys[16] = { 20, 10, 15, 20, 2, 2, 1, 1 };
 
+// assets drawn every frame, looked up once on entering the game
+static struct {
+    bool resolved;
+    SpriteID tgBack[4];
+    SpriteID tgFront[4];
+    SpriteID heartFull;
+    SpriteID heartHalf;
+    SpriteID heartNone;
+    SpriteID ninepatch;
+    SpriteID invPanel;
+    SpriteID invPanelBack;
+    SpriteID invTabs;
+    SpriteID invSlot;
+    SpriteID invEmpty;
+    BFontID dialog;
+    BFontID dialogGray;
+    BFontID invDetail1;
+    BFontID invDetail2;
+    BFontID invBig;
+} _ids;
+
 // ===== [[ Implementations ]] =====
 
 void Game_init(void) {
+    Entity_init();
 }
 
 void Game_reload(void) {
@@ -107,9 +133,21 @@ void Game_reload(void) {
     _camsnap = true;
 }
 
+// Load the region again after its files change, keeping the player where
+// they are along with the inventory and quests
+void Game_reloadRegion(void) {
+    int player = Entity_getPlayer();
+    Entity_destroyAllBut(player);
+    Field_clear();
+    _tallGrassCount = 0;
+    Region_load(2);
+    if (player != -1) Entity_destroyPlayersBut(player);
+}
+
 void Game_enter(void) {
     _substate = GameSubstate_interact;
     _sel = 0;
+    _resolveIds();
     Game_reload();
     Music_play(Music_find("explore"));
 }
@@ -133,6 +171,11 @@ void Game_update(void) {
         case GameSubstate_demoWon: _updateDemoWon(); break;
         case GameSubstate_shop: _updateShop(); break;
     }
+
+    // all animation time advances here, paused during hitstop
+    bool animate = Game_shouldAnimate();
+    Entity_updateAnimations(animate);
+    if (animate) Animation_update();
 }
 
 void Game_render(void) {
@@ -343,6 +386,12 @@ static void _updateInventory(void) {
 }
 
 static void _updateDialog(void) {
+    // type the text out a character every other tick
+    if (_dialogTextTimer/2 < 128) {
+        _dialogTextTimer++;
+        if (strlen(_getDialogText()) <= _dialogTextTimer/2) _dialogTextTimer = 256;
+    }
+
     if (Input_isPressed(InputButton_up) && _sel > 0) {
         _sel--; 
     }
@@ -492,7 +541,7 @@ static void _renderPause(void) {
     Draw_setColor(Color_white);
     // BFontID fnt = BFont_find("inv_detail1");
     // BFont_drawText(fnt, bx+10, by+10, "## PAUSED ##");
-    BFontID bf = BFont_find("dialog");
+    BFontID bf = _ids.dialog;
     BFont_drawText(bf, bx+10, by+10, "-- Paused --");
     BFont_drawText(bf, bx+10, by+26, "  Resume");
     BFont_drawText(bf, bx+10, by+26+16, "  Quit");
@@ -504,9 +553,9 @@ static void _renderInventory(void) {
 
     // show hearts/status effects also
     {
-        SpriteID heartFull = Sprite_find("ui/heartfull");
-        SpriteID heartHalf = Sprite_find("ui/hearthalf");
-        SpriteID heartNone = Sprite_find("ui/heartnone");
+        SpriteID heartFull = _ids.heartFull;
+        SpriteID heartHalf = _ids.heartHalf;
+        SpriteID heartNone = _ids.heartNone;
 
         int playerID = Entity_getPlayer();
         if (playerID == -1) return;
@@ -538,19 +587,19 @@ static void _renderInventory(void) {
     // Draw_rect(0, 0, 400, 32*8+20);
     Draw_setTranslate(xt, 0);
 
-    SpriteID invPanel = Sprite_find("ui/invPanel");
+    SpriteID invPanel = _ids.invPanel;
     Sprite_draw(invPanel, 30, 39);
-    SpriteID invPanelBack = Sprite_find("ui/invPanelBack");
+    SpriteID invPanelBack = _ids.invPanelBack;
     Sprite_draw(invPanelBack, 30+9, 39+126);
-    SpriteID invTabs = Sprite_find("ui/invTabs");
+    SpriteID invTabs = _ids.invTabs;
     Sprite_draw(invTabs, 30, 15);
 
-    SpriteID invSlot = Sprite_find("ui/invSlot");
-    SpriteID invEmpty = Sprite_find("ui/invEmpty");
+    SpriteID invSlot = _ids.invSlot;
+    SpriteID invEmpty = _ids.invEmpty;
 
-    BFontID fntDark = BFont_find("inv_detail1");
-    BFontID fnt = BFont_find("inv_detail2");
-    BFontID fntBig = BFont_find("inv_big");
+    BFontID fntDark = _ids.invDetail1;
+    BFontID fnt = _ids.invDetail2;
+    BFontID fntBig = _ids.invBig;
 
     Draw_setTranslate(xt, -_invScroll/100);
     const int stride = 23;
@@ -613,32 +662,33 @@ static void _renderInventory(void) {
 
     Draw_setTranslate(0, 0);
     _drawNinepatch(SCREEN_WIDTH-80, 4, 80-8, 16);
-    BFontID bf_dialog = BFont_find("dialog");
+    BFontID bf_dialog = _ids.dialog;
     BFont_drawText(bf_dialog, SCREEN_WIDTH-80+4, 8, "%4d crowns", _gold);
 }
 
-static void _renderDialog(void) {
-    _renderWorld();
-
+static const char* _getDialogText(void) {
     VillagerID villager = Entity_getVillager(_dialogPartner);
     const char* dialog = (_dialogLine != -1) ?
         Dialog_getMessage(_dialogLine) :
         Villager_getDialog(villager);
     if (!dialog || !dialog[0]) dialog = "It looks like it might start raining soon.";
+    return dialog;
+}
+
+static void _renderDialog(void) {
+    _renderWorld();
+
+    VillagerID villager = Entity_getVillager(_dialogPartner);
+    const char* dialog = _getDialogText();
 
     const char* title = Villager_getTitle(villager);
     if (!title) title = "Charlie";
 
-
-    if (_dialogTextTimer/2 < 128) {
-        _dialogTextTimer++;
-        if (strlen(dialog) <= _dialogTextTimer/2) _dialogTextTimer = 256;
-    }
     Draw_setColor(Color_ltgray);
     _drawNinepatch(10, SCREEN_HEIGHT - 90, SCREEN_WIDTH - 20, 80);
     Draw_setColor(Color_white);
     // Draw_text(20, SCREEN_HEIGHT - 80, "%.*s", _dialogTextTimer/2, dialog);
-    BFontID bf_dialog = BFont_find("dialog");
+    BFontID bf_dialog = _ids.dialog;
     BFont_drawTextExt(bf_dialog,
         20, SCREEN_HEIGHT - 80, SCREEN_WIDTH - 20 - 100, 0.0f,
         "%.*s", _dialogTextTimer/2, dialog
@@ -670,8 +720,8 @@ static void _renderCrafting(void) {
     _renderWorld();
     Draw_setColor(Color_dkgray);
     _drawNinepatch(40, 40, SCREEN_WIDTH-80, 16*_craftRecipeCount+20);
-    BFontID bf = BFont_find("dialog");
-    BFontID bfgray = BFont_find("dialog_gray");
+    BFontID bf = _ids.dialog;
+    BFontID bfgray = _ids.dialogGray;
     for (int i = 0; i < _craftRecipeCount; i++) {
         RecipeID recipe = _craftRecipes[i];
         ItemID item = Recipe_getOutput(recipe);
@@ -712,7 +762,7 @@ static void _renderChest(void) {
     _renderWorld();
     Draw_setColor(Color_dkgray);
     _drawNinepatch(40, 40, SCREEN_WIDTH-80, 16*_chestCount+20);
-    BFontID bf = BFont_find("dialog");
+    BFontID bf = _ids.dialog;
     for (int i = 0; i < _chestCount; i++) {
         ItemID item = _chestItems[i];
         const char* name = Item_getDisplayName(item);
@@ -729,7 +779,7 @@ static void _renderGameOver(void) {
     _renderWorld();
     int x = SCREEN_WIDTH/2-100, y = SCREEN_HEIGHT/2-40;
     _drawNinepatch(x, y, 200, 80);
-    BFontID bf = BFont_find("dialog");
+    BFontID bf = _ids.dialog;
     BFont_drawTextExt(bf, x+10, y+10, 180, 0.5f, "GAME OVER");
     BFont_drawText(bf, x+10, y+30, "Press ESCAPE to return to menu.");
 }
@@ -737,7 +787,7 @@ static void _renderGameOver(void) {
 static void _renderDemoWon(void) {
     int x = SCREEN_WIDTH/2-100, y = SCREEN_HEIGHT/2-40;
     _drawNinepatch(x, y, 200, 80);
-    BFontID bf = BFont_find("dialog");
+    BFontID bf = _ids.dialog;
     BFont_drawTextExt(bf, x+10, y+10, 180, 0.5f, "END OF DEMO");
     BFont_drawText(bf, x+10, y+30, "Press ESCAPE to return to menu.");
     BFont_drawText(bf, x+10, y+50, "Press ENTER to continue playing.");
@@ -747,8 +797,8 @@ static void _renderShop(void) {
     _renderWorld();
     Draw_setColor(Color_dkgray);
     _drawNinepatch(40, 40, SCREEN_WIDTH-80, 16*_chestCount+20);
-    BFontID bf = BFont_find("dialog");
-    BFontID bfgray = BFont_find("dialog_gray");
+    BFontID bf = _ids.dialog;
+    BFontID bfgray = _ids.dialogGray;
     for (int i = 0; i < _chestCount; i++) {
         ItemID item = _chestItems[i];
         const char* name = Item_getDisplayName(item);
@@ -769,7 +819,7 @@ static void _renderShop(void) {
     BFont_drawText(bf, 50, 50+16*_sel, ">");
     Draw_setColor(Color_white);
     _drawNinepatch(SCREEN_WIDTH-80, 4, 80-8, 16);
-    BFontID bf_dialog = BFont_find("dialog");
+    BFontID bf_dialog = _ids.dialog;
     BFont_drawText(bf_dialog, SCREEN_WIDTH-80+4, 8, "%4d crowns", _gold);
 }
 
@@ -805,6 +855,9 @@ static void _updateWorld(void) {
     Particles_update();
 
     // update camera
+    _prevCamx = _camx;
+    _prevCamy = _camy;
+    _camTick = Main_getTick();
     int playerID = Entity_getPlayer();
     if (playerID != -1) {
         int px = Entity_getX(playerID);
@@ -819,28 +872,28 @@ static void _updateWorld(void) {
         }
         _camx += (int) ceilf(dx * f);
         _camy += (int) ceilf(dy * f);
+        if (f == 1.0f) {
+            _prevCamx = _camx;
+            _prevCamy = _camy;
+        }
     }
 }
 
 static void _renderWorld(void) {
+    // between the last two ticks, like entities
+    float alpha = _camTick == Main_getTick() ? Main_getTickAlpha() : 1;
+    int camx = _prevCamx + (int) ((_camx - _prevCamx) * alpha);
+    int camy = _prevCamy + (int) ((_camy - _prevCamy) * alpha);
     Draw_setTranslate(
-        -_camx/16 + SCREEN_WIDTH / 2,
-        -_camy/16 + SCREEN_HEIGHT / 2);
+        -camx/16 + SCREEN_WIDTH / 2,
+        -camy/16 + SCREEN_HEIGHT / 2);
     Region_render(0);
     Region_render(1);
     SpriteQueue_clear();
     Entity_renderAll();
     Particles_draw();
-    SpriteID tgBack[4];
-    tgBack[0] = Sprite_find("tgBackMid");
-    tgBack[1] = Sprite_find("tgBackLeft");
-    tgBack[2] = Sprite_find("tgBackRight");
-    tgBack[3] = Sprite_find("tgBackSingle");
-    SpriteID tgFront[4];
-    tgFront[0] = Sprite_find("tgFrontMid");
-    tgFront[1] = Sprite_find("tgFrontLeft");
-    tgFront[2] = Sprite_find("tgFrontRight");
-    tgFront[3] = Sprite_find("tgFrontSingle");
+    SpriteID* tgBack = _ids.tgBack;
+    SpriteID* tgFront = _ids.tgFront;
     for (int i = 0; i < _tallGrassCount; i++) {
         TallGrass* tg = &_tallGrasses[i];
         SpriteQueue_addSprite(tgBack[tg->side], tg->tx*16, tg->ty*16+8, 0);
@@ -875,9 +928,9 @@ static void _renderWorld(void) {
 }
 
 static void _renderHud(void) {
-    SpriteID heartFull = Sprite_find("ui/heartfull");
-    SpriteID heartHalf = Sprite_find("ui/hearthalf");
-    SpriteID heartNone = Sprite_find("ui/heartnone");
+    SpriteID heartFull = _ids.heartFull;
+    SpriteID heartHalf = _ids.heartHalf;
+    SpriteID heartNone = _ids.heartNone;
 
     int playerID = Entity_getPlayer();
     if (playerID == -1) return;
@@ -903,8 +956,8 @@ static void _renderHud(void) {
         }
     }
 
-    BFontID bf = BFont_find("dialog");
-    BFontID bfgray = BFont_find("dialog_gray");
+    BFontID bf = _ids.dialog;
+    BFontID bfgray = _ids.dialogGray;
     if (_showHintText) {
         if (_hintTextTimer/2 < 128) _hintTextTimer++;
         int width = Draw_getTextWidth("%.*s", _hintTextTimer/2, _hintText) * 0.85f;
@@ -964,7 +1017,7 @@ static void _renderHud(void) {
 }
 
 static void _drawNinepatch(int x, int y, int w, int h) {
-    SpriteID spr_base = Sprite_find("menu/9ptl");
+    SpriteID spr_base = _ids.ninepatch;
 
     // todo: big hack, just assuming next sprites are sequential
     SpriteID spr_parts[9];
@@ -1005,3 +1058,30 @@ static int _questCompare(const void* a, const void* b) {
     QuestID qb = *(QuestID*) b;
     return Quest_getPriority(qb) - Quest_getPriority(qa);
 }
+
+static void _resolveIds(void) {
+    if (_ids.resolved) return;
+    _ids.resolved = true;
+    _ids.tgBack[0] = Sprite_find("tgBackMid");
+    _ids.tgBack[1] = Sprite_find("tgBackLeft");
+    _ids.tgBack[2] = Sprite_find("tgBackRight");
+    _ids.tgBack[3] = Sprite_find("tgBackSingle");
+    _ids.tgFront[0] = Sprite_find("tgFrontMid");
+    _ids.tgFront[1] = Sprite_find("tgFrontLeft");
+    _ids.tgFront[2] = Sprite_find("tgFrontRight");
+    _ids.tgFront[3] = Sprite_find("tgFrontSingle");
+    _ids.heartFull = Sprite_find("ui/heartfull");
+    _ids.heartHalf = Sprite_find("ui/hearthalf");
+    _ids.heartNone = Sprite_find("ui/heartnone");
+    _ids.ninepatch = Sprite_find("menu/9ptl");
+    _ids.invPanel = Sprite_find("ui/invPanel");
+    _ids.invPanelBack = Sprite_find("ui/invPanelBack");
+    _ids.invTabs = Sprite_find("ui/invTabs");
+    _ids.invSlot = Sprite_find("ui/invSlot");
+    _ids.invEmpty = Sprite_find("ui/invEmpty");
+    _ids.dialog = BFont_find("dialog");
+    _ids.dialogGray = BFont_find("dialog_gray");
+    _ids.invDetail1 = BFont_find("inv_detail1");
+    _ids.invDetail2 = BFont_find("inv_detail2");
+    _ids.invBig = BFont_find("inv_big");
+}
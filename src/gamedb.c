@@ -0,0 +1,283 @@
+#include "common.h"
+
+// Compiled game database. Every table the loaders build from INI files
+// holds plain structs with names already resolved to ids, so the compiler
+// (--compile-db) runs the normal loaders once and dumps the arrays as
+// entries of an ARC0 archive. The game then copies them straight back in.
+// A layout hash of table names and struct sizes guards against loading a
+// database built by a different version of the game, and a hash of the INI
+// files it was built from against loading one that's older than them.
+
+// ===== [[ Defines ]] =====
+
+#define GAMEDB_VERSION 2
+#define MAX_GAMEDB_TABLES 32
+#define GAMEDB_NAME_LENGTH 24 // archive entry name length
+#define GAMEDB_HEADER_ENTRY "_header"
+
+// ===== [[ Local Types ]] =====
+
+typedef struct {
+    const char* name;
+    void* data;
+    int size; // of one element
+    int* count;
+    int max;
+    GameDbRestoreFn restore;
+} GameDbTable;
+
+typedef struct {
+    char magic[4];
+    int version;
+    uint32_t layout;
+    uint32_t assets; // hash of the table INI files
+    int tableCount;
+} GameDbHeader;
+
+// ===== [[ Declarations ]] =====
+
+static void _registerTables(void);
+static uint32_t _layoutHash(void);
+static uint32_t _assetHash(void);
+static uint32_t _hashBytes(uint32_t hash, const void* data, size_t size);
+
+// ===== [[ Static Data ]] =====
+
+static GameDbTable _tables[MAX_GAMEDB_TABLES];
+static int _tableCount;
+static bool _registered;
+
+// ===== [[ Implementations ]] =====
+
+void GameDb_addTable(const char* name, void* data, int size, int* count,
+        int max, GameDbRestoreFn restore) {
+    if (_tableCount == MAX_GAMEDB_TABLES) {
+        Log_error("Max game database tables exceeded");
+        return;
+    }
+    if (strlen(name) >= GAMEDB_NAME_LENGTH) {
+        Log_error("Game database table name too long: %s", name);
+        return;
+    }
+
+    GameDbTable* table = &_tables[_tableCount++];
+    table->name = name;
+    table->data = data;
+    table->size = size;
+    table->count = count;
+    table->max = max;
+    table->restore = restore;
+}
+
+bool GameDb_write(const char* path) {
+    _registerTables();
+
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        Log_error("Failed to open %s for writing", path);
+        return false;
+    }
+
+    // ARC0: 16 byte header, 32 byte entries, then 16 byte aligned data
+    int entryCount = _tableCount + 1;
+    int offsets[MAX_GAMEDB_TABLES + 1];
+    int sizes[MAX_GAMEDB_TABLES + 1];
+    int offset = 16 + 32 * entryCount;
+    sizes[0] = sizeof(GameDbHeader);
+    for (int i = 0; i < entryCount; i++) {
+        if (i > 0) sizes[i] = _tables[i - 1].size * *_tables[i - 1].count;
+        offsets[i] = offset;
+        offset += (sizes[i] + 15) & ~15;
+    }
+
+    int arcHeader[4] = {0, 100, entryCount, 0};
+    memcpy(arcHeader, "ARC0", 4);
+    fwrite(arcHeader, sizeof(arcHeader), 1, f);
+    for (int i = 0; i < entryCount; i++) {
+        char name[GAMEDB_NAME_LENGTH] = {0};
+        strncpy(name, i == 0 ? GAMEDB_HEADER_ENTRY : _tables[i - 1].name,
+                GAMEDB_NAME_LENGTH - 1);
+        fwrite(&offsets[i], sizeof(int), 1, f);
+        fwrite(&sizes[i], sizeof(int), 1, f);
+        fwrite(name, GAMEDB_NAME_LENGTH, 1, f);
+    }
+
+    GameDbHeader header = {{'H', 'G', 'D', 'B'}, GAMEDB_VERSION,
+            _layoutHash(), _assetHash(), _tableCount};
+    for (int i = 0; i < entryCount; i++) {
+        if (i == 0) {
+            fwrite(&header, sizeof(header), 1, f);
+        } else if (sizes[i] > 0) {
+            fwrite(_tables[i - 1].data, sizes[i], 1, f);
+        }
+        for (int pad = sizes[i]; pad % 16; pad++) fputc(0, f);
+    }
+
+    bool ok = !ferror(f);
+    fclose(f);
+    if (ok) Log_info("wrote %d tables (%d bytes) to %s", _tableCount, offset, path);
+    return ok;
+}
+
+bool GameDb_load(const char* path) {
+    _registerTables();
+
+    Archive arc = Archive_open(path);
+    if (!arc) {
+        Log_warn("No game database at %s, loading INI files", path);
+        return false;
+    }
+
+    size_t size;
+    const GameDbHeader* header = Archive_getSize(arc, GAMEDB_HEADER_ENTRY) ?
+            Archive_view(arc, GAMEDB_HEADER_ENTRY, &size) : NULL;
+    if (!header || size < sizeof(GameDbHeader) ||
+            memcmp(header->magic, "HGDB", 4) != 0 ||
+            header->version != GAMEDB_VERSION ||
+            header->layout != _layoutHash() ||
+            header->tableCount != _tableCount) {
+        Log_warn("Game database %s is out of date, loading INI files", path);
+        Archive_close(arc);
+        return false;
+    }
+    if (header->assets != _assetHash()) {
+        Log_warn("Game database %s doesn't match the INI files, "
+                "loading INI files", path);
+        Archive_close(arc);
+        return false;
+    }
+
+    // check everything before touching any table
+    for (int i = 0; i < _tableCount; i++) {
+        GameDbTable* table = &_tables[i];
+        size_t tableSize = Archive_getSize(arc, table->name);
+        if (tableSize % table->size != 0 ||
+                tableSize / table->size > (size_t) table->max ||
+                (tableSize && !Archive_view(arc, table->name, &size))) {
+            Log_warn("Bad table %s in game database, loading INI files",
+                    table->name);
+            Archive_close(arc);
+            return false;
+        }
+    }
+
+    for (int i = 0; i < _tableCount; i++) {
+        GameDbTable* table = &_tables[i];
+        size_t tableSize = Archive_getSize(arc, table->name);
+        if (tableSize) {
+            memcpy(table->data, Archive_view(arc, table->name, &size), tableSize);
+        }
+        *table->count = tableSize / table->size;
+    }
+    Archive_close(arc);
+    NameIndex_invalidateAll();
+
+    // bring back textures and sounds the tables refer to
+    for (int i = 0; i < _tableCount; i++) {
+        if (_tables[i].restore) _tables[i].restore();
+    }
+    return true;
+}
+
+// Copy every table and its count, so a reload that goes wrong can be
+// undone. Sizes are fixed by then, the tables only change contents.
+void* GameDb_snapshot(void) {
+    _registerTables();
+
+    size_t size = sizeof(int) * _tableCount;
+    for (int i = 0; i < _tableCount; i++) {
+        size += (size_t) _tables[i].size * *_tables[i].count;
+    }
+    uint8_t* snapshot = malloc(size ? size : 1);
+    SDLAssert(snapshot);
+
+    uint8_t* p = snapshot;
+    for (int i = 0; i < _tableCount; i++) {
+        GameDbTable* table = &_tables[i];
+        size_t tableSize = (size_t) table->size * *table->count;
+        memcpy(p, table->count, sizeof(int));
+        memcpy(p + sizeof(int), table->data, tableSize);
+        p += sizeof(int) + tableSize;
+    }
+    return snapshot;
+}
+
+void GameDb_restoreSnapshot(void* snapshot) {
+    const uint8_t* p = snapshot;
+    for (int i = 0; i < _tableCount; i++) {
+        GameDbTable* table = &_tables[i];
+        memcpy(table->count, p, sizeof(int));
+        size_t tableSize = (size_t) table->size * *table->count;
+        memcpy(table->data, p + sizeof(int), tableSize);
+        p += sizeof(int) + tableSize;
+    }
+    NameIndex_invalidateAll();
+    free(snapshot);
+}
+
+void GameDb_freeSnapshot(void* snapshot) {
+    free(snapshot);
+}
+
+static void _registerTables(void) {
+    if (_registered) return;
+    _registered = true;
+
+    Sprite_registerTables();
+    BFont_registerTables();
+    Audio_registerTables();
+    Particles_registerTables();
+    Entity_registerTables();
+    Item_registerTables();
+    Recipe_registerTables();
+    Villager_registerTables();
+    Quest_registerTables();
+    Dialog_registerTables();
+}
+
+static uint32_t _layoutHash(void) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < _tableCount; i++) {
+        hash = _hashBytes(hash, _tables[i].name, strlen(_tables[i].name));
+        hash = (hash ^ (uint32_t) _tables[i].size) * 16777619u;
+        hash = (hash ^ (uint32_t) _tables[i].max) * 16777619u;
+    }
+    return hash;
+}
+
+// Contents of every table INI file, from the asset archive if they're
+// packed or the assets directory otherwise, the same way Ini_readAsset
+// finds them
+static uint32_t _assetHash(void) {
+    uint32_t hash = 2166136261u;
+    Archive arc = Config_assetArchive[0] ?
+            Archive_get(Config_assetArchive) : NULL;
+    for (int i = 0; i < Loading_tableAssetCount; i++) {
+        const char* asset = Loading_tableAssets[i];
+        hash = _hashBytes(hash, asset, strlen(asset) + 1);
+        if (arc && Archive_getSize(arc, asset)) {
+            size_t size;
+            const void* data = Archive_view(arc, asset, &size);
+            hash = _hashBytes(hash, data, size);
+            continue;
+        }
+
+        char path[256];
+        snprintf(path, sizeof(path), "assets/%s", asset);
+        FILE* f = fopen(path, "rb");
+        if (!f) continue;
+        uint8_t buffer[4096];
+        size_t read;
+        while ((read = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+            hash = _hashBytes(hash, buffer, read);
+        }
+        fclose(f);
+    }
+    return hash;
+}
+
+static uint32_t _hashBytes(uint32_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = data;
+    for (size_t i = 0; i < size; i++) hash = (hash ^ bytes[i]) * 16777619u;
+    return hash;
+}
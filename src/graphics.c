@@ -6,6 +6,8 @@
 #define MAX_SPRITE_IMAGES 32
 #define MAX_SPRITES 512
 #define MAX_ANIMATIONS 256
+#define MAX_ANIMATION_FRAMES 64
+#define MAX_ANIMATION_TICKS 32768
 #define MAX_QUEUE_ENTRIES 2048
 
 // ===== [[ Local Types ]] =====
@@ -30,16 +32,14 @@ typedef struct {
     char name[NAME_LENGTH];
     short frameCount;
     bool isPingPong;
-    int frameSprites[8];
-    int frameDurations[8]; // in 16ms units (i.e. 60fps frames)
-    int totalDuration;
-    int forwardDuration; // for ping pong only, duration minus last frame
-    int reverseDelta; // for ping pong only, time offset for reverse
+    int totalDuration; // in 16ms units (i.e. 60fps frames)
+    int timelineStart; // index of first tick in _animationTimeline
 } Animation;
 
 typedef enum {
     QueueEntryKind_sprite,
-    QueueEntryKind_animation
+    QueueEntryKind_animation,
+    QueueEntryKind_batch
 } QueueEntryKind;
 
 typedef struct {
@@ -57,12 +57,17 @@ typedef struct {
             AnimationID animationID;
             int time;
         } asAnimation;
+        struct {
+            SpriteQueueBatchFn fn;
+            int arg;
+        } asBatch;
     } data;
 } QueueEntry;
 
 // ===== [[ Declarations ]] =====
 
 static SpriteImageID _findSpriteImage(const char* assetpath);
+static void _restoreSpriteImages(void);
 static QueueEntry* _queueAllocate(QueueEntryKind kind, int x, int y, int z);
 
 // ===== [[ Static Data ]] =====
@@ -70,30 +75,77 @@ static QueueEntry* _queueAllocate(QueueEntryKind kind, int x, int y, int z);
 static SpriteImage _spriteImages[MAX_SPRITE_IMAGES];
 static Sprite _sprites[MAX_SPRITES];
 static Animation _animations[MAX_ANIMATIONS];
+// decoded by prefetches, waiting for Sprite_loadImage to upload them
+static DecodedImage _decodedImages[MAX_SPRITE_IMAGES];
 
 static int _spriteImageCount;
 static int _spriteCount;
+static NameIndex _spriteIndex = NAME_INDEX(_sprites, _spriteCount);
 static int _animationCount;
+static NameIndex _animationIndex = NAME_INDEX(_animations, _animationCount);
 static int _animationGlobalTimer;
 
+// sprite to show for every tick of every animation, baked at load
+static SpriteID _animationTimeline[MAX_ANIMATION_TICKS];
+static int _animationTimelineSize;
+
 static bool _hasModColor;
 static int _modColor[3];
 
 static QueueEntry _queueEntries[MAX_QUEUE_ENTRIES];
 static int _queueEntryCount;
-static bool _maxQueueWarningShown;
 
 // ===== [[ Implementations ]] =====
 
-void Sprite_setSpriteImage(const char* assetpath, SDL_Texture* texture) {
-    if (_spriteImageCount == MAX_SPRITE_IMAGES) {
-        puts("error: too many sprite images");
-        return;
+// Residency callbacks, images are loaded on their first draw. Prefetched
+// ones are decoded on a loader thread first and only uploaded here.
+void Sprite_decodeImage(int image) {
+    char filepath[MAX_ASSETPATH_LENGTH * 2];
+    snprintf(filepath, sizeof(filepath), "assets/images/%s",
+            _spriteImages[image].assetpath);
+    _decodedImages[image] = Loading_decodeImage(filepath);
+}
+
+size_t Sprite_loadImage(int image) {
+    if (!_decodedImages[image]) Sprite_decodeImage(image);
+    SDL_Texture* texture = Loading_uploadImage(_decodedImages[image]);
+    _decodedImages[image] = NULL;
+    _spriteImages[image].texture = texture;
+    // failed, not drawn until it's evicted and tried again
+    if (!texture) return 0;
+
+    int w, h;
+    SDL_QueryTexture(texture, NULL, NULL, &w, &h);
+    return (size_t) w * h * 4;
+}
+
+bool Sprite_unloadImage(int image) {
+    SDL_DestroyTexture(_spriteImages[image].texture);
+    _spriteImages[image].texture = NULL;
+    return true;
+}
+
+// Drop an image if any sprite uses it, for hot reloading. The new one is
+// loaded on its next draw.
+bool Sprite_reloadImage(const char* assetpath) {
+    for (int i = 0; i < _spriteImageCount; i++) {
+        if (strcmp(_spriteImages[i].assetpath, assetpath) == 0) {
+            Residency_evict(ResidentKind_image, i);
+            return true;
+        }
     }
+    return false;
+}
 
-    SpriteImageID id = _spriteImageCount++;
-    strncpy(_spriteImages[id].assetpath, assetpath, MAX_ASSETPATH_LENGTH);
-    _spriteImages[id].texture = texture;
+void Sprite_registerTables(void) {
+    GameDb_addTable("spriteImages", _spriteImages, sizeof(SpriteImage),
+            &_spriteImageCount, MAX_SPRITE_IMAGES, _restoreSpriteImages);
+    GameDb_addTable("sprites", _sprites, sizeof(Sprite),
+            &_spriteCount, MAX_SPRITES, NULL);
+    GameDb_addTable("animations", _animations, sizeof(Animation),
+            &_animationCount, MAX_ANIMATIONS, NULL);
+    GameDb_addTable("animationTimeline", _animationTimeline, sizeof(SpriteID),
+            &_animationTimelineSize, MAX_ANIMATION_TICKS, NULL);
 }
 
 void Sprite_loadFrom(const char* assetpath) {
@@ -108,11 +160,13 @@ void Sprite_loadFrom(const char* assetpath) {
             return;
         }
 
-        Sprite* sprite = &_sprites[_spriteCount++];
+        Sprite* sprite = &_sprites[NameIndex_add(&_spriteIndex, name)];
         strncpy(sprite->name, name, NAME_LENGTH);
+        int imageLength;
+        const char* image = Ini_getSlice(name, "image", &imageLength);
         char imagePath[MAX_ASSETPATH_LENGTH];
         snprintf(imagePath, MAX_ASSETPATH_LENGTH,
-                "%s", Ini_get(name, "image"));
+                "%.*s", imageLength, image ? image : "");
         sprite->image = _findSpriteImage(imagePath);
 
         sprite->w = 16;
@@ -144,38 +198,82 @@ void Animation_loadFrom(const char* assetpath) {
             return;
         }
 
-        Animation* animation = &_animations[_animationCount++];
+        // a reload keeps the old ticks if this one has problems. new slots
+        // may hold whatever a rolled back reload left there
+        bool reloading = NameIndex_find(&_animationIndex, name) != -1;
+        Animation* animation =
+                &_animations[NameIndex_add(&_animationIndex, name)];
+        Animation old = {0};
+        if (reloading) old = *animation;
         strncpy(animation->name, name, NAME_LENGTH);
-        
+        int issues = Log_getIssueCount();
+
         animation->isPingPong =
                 String_parseBool(Ini_get(name, "pingpong"), false);
-        
+
+        int frameSprites[MAX_ANIMATION_FRAMES];
+        int frameDurations[MAX_ANIMATION_FRAMES];
         const char* spritesString = Ini_get(name, "sprites");
         animation->frameCount = String_parseIntArrayExt(
-            spritesString, animation->frameSprites, 8, Sprite_find);
+            spritesString, frameSprites, MAX_ANIMATION_FRAMES, Sprite_find);
 
         const char* durationsString = Ini_get(name, "durations");
         int durationsCount = String_parseIntArray(
-            durationsString, animation->frameDurations, 8);
+            durationsString, frameDurations, MAX_ANIMATION_FRAMES);
         if (durationsCount < animation->frameCount) {
             for (int j = durationsCount; j < animation->frameCount; j++) {
-                animation->frameDurations[j] = 1;
+                frameDurations[j] = 1;
             }
         }
 
         int total = 0;
         for (int i = 0; i < animation->frameCount; i++) {
-            total += animation->frameDurations[i];
+            total += frameDurations[i];
         }
         animation->totalDuration = total;
 
+        // for ping pong, play forward then back without repeating the ends
+        int forwardDuration = 0;
+        int reverseDelta = 0;
         if (animation->isPingPong && total > 0) {
-            animation->forwardDuration =
-                    total - animation->frameDurations[animation->frameCount - 1];
-            animation->reverseDelta = animation->forwardDuration - 1 + total;
+            forwardDuration = total - frameDurations[animation->frameCount - 1];
+            reverseDelta = forwardDuration - 1 + total;
+            animation->totalDuration = forwardDuration +
+                    total - frameDurations[0];
+        }
 
-            animation->totalDuration = animation->forwardDuration +
-                    total - animation->frameDurations[0];
+        // bake tick -> sprite timeline into the free ticks past the end
+        if (_animationTimelineSize + animation->totalDuration >
+                MAX_ANIMATION_TICKS) {
+            Log_error("Max animation ticks exceeded");
+            animation->totalDuration = 0;
+        }
+        SpriteID* ticks = &_animationTimeline[_animationTimelineSize];
+        for (int tick = 0; tick < animation->totalDuration; tick++) {
+            int time = tick;
+            if (animation->isPingPong && time > forwardDuration) {
+                time = reverseDelta - time;
+            }
+            int frame = 0;
+            while (frame < animation->frameCount - 1 &&
+                    frameDurations[frame] <= time) {
+                time -= frameDurations[frame];
+                frame++;
+            }
+            ticks[tick] = frameSprites[frame];
+        }
+
+        // then keep them there, or move them over the old ticks when
+        // reloading an animation that got no longer
+        if (reloading && Log_getIssueCount() != issues) {
+            *animation = old;
+        } else if (reloading && animation->totalDuration <= old.totalDuration) {
+            animation->timelineStart = old.timelineStart;
+            memmove(&_animationTimeline[old.timelineStart], ticks,
+                    sizeof(SpriteID) * animation->totalDuration);
+        } else {
+            animation->timelineStart = _animationTimelineSize;
+            _animationTimelineSize += animation->totalDuration;
         }
     }
 
@@ -184,13 +282,19 @@ void Animation_loadFrom(const char* assetpath) {
 
 SpriteID Sprite_find(const char* name) {
     if (!name) return -1;
-    for (int i = 0; i < _spriteCount; i++) {
-        if (strcmp(_sprites[i].name, name) == 0) return i;
-    }
+    int id = NameIndex_find(&_spriteIndex, name);
+    if (id != -1) return id;
     Log_warn("Cannot find sprite %s", name);
     return -1;
 }
 
+// Load a sprite's image ahead of its first draw
+void Sprite_prefetch(SpriteID self) {
+    if (self < 0 || self >= _spriteCount) return;
+    if (_sprites[self].image == -1) return;
+    Residency_prefetch(ResidentKind_image, _sprites[self].image);
+}
+
 void Sprite_draw(SpriteID self, int x, int y) {
     Sprite_drawScaled(self, x, y, -1, -1);
 }
@@ -199,6 +303,7 @@ void Sprite_drawScaled(SpriteID self, int x, int y, int w, int h) {
     if (self < 0 || self > _spriteCount) return;
     Sprite* sprite = &_sprites[self];
     if (sprite->image == -1) return;
+    if (!Residency_use(ResidentKind_image, sprite->image)) return;
     SDL_Texture* texture = _spriteImages[sprite->image].texture;
 
     if (!texture) return;
@@ -210,18 +315,26 @@ void Sprite_drawScaled(SpriteID self, int x, int y, int w, int h) {
     SDL_Rect dst = { x - sprite->ox, y - sprite->oy, w, h };
     Draw_translatePoint(&dst.x, &dst.y);
     SDL_RenderCopyEx(Main_renderer, texture, &src, &dst, 0, NULL, sprite->flip);
+    PROFILE_COUNT(renderCopies, 1);
     if (_hasModColor) SDL_SetTextureColorMod(texture, 255, 255, 255);
 }
 
 AnimationID Animation_find(const char* name) {
     if (!name) return -1;
-    for (int i = 0; i < _animationCount; i++) {
-        if (strcmp(_animations[i].name, name) == 0) return i;
-    }
+    int id = NameIndex_find(&_animationIndex, name);
+    if (id != -1) return id;
     Log_warn("Cannot find animation %s", name);
     return -1;
 }
 
+void Animation_prefetch(AnimationID self) {
+    if (self < 0 || self >= _animationCount) return;
+    Animation* animation = &_animations[self];
+    for (int tick = 0; tick < animation->totalDuration; tick++) {
+        Sprite_prefetch(_animationTimeline[animation->timelineStart + tick]);
+    }
+}
+
 int Animation_getDuration(AnimationID self) {
     if (self < 0 || self > _animationCount) return 0;
     return _animations[self].totalDuration;
@@ -231,26 +344,12 @@ void Animation_draw(AnimationID self, int x, int y, int* timePointer) {
     if (self < 0 || self > _animationCount) return;
     Animation* animation = &_animations[self];
 
-    int time;
-    if (Game_shouldAnimate()) {
-        time = timePointer ? (*timePointer)++ : _animationGlobalTimer;
-    } else {
-        time = timePointer ? *timePointer : _animationGlobalTimer;
-    }
-    time = time % animation->totalDuration;
-    if (animation->isPingPong && time > animation->forwardDuration) {
-        time = animation->reverseDelta - time;
-    }
-
-    int baseTime = time;
-
-    int frame = 0;
-    while (frame < 8 && animation->frameDurations[frame] <= time) {
-        time -= animation->frameDurations[frame];
-        frame++;
-    }
+    if (animation->totalDuration == 0) return;
 
-    Sprite_draw(animation->frameSprites[frame], x, y);
+    int time = timePointer ? *timePointer : _animationGlobalTimer;
+    int tick = time % animation->totalDuration;
+    if (tick < 0) tick += animation->totalDuration;
+    Sprite_draw(_animationTimeline[animation->timelineStart + tick], x, y);
 }
 
 void Animation_update(void) {
@@ -283,10 +382,19 @@ void SpriteQueue_addAnim(AnimationID animationID, int x, int y, int z, int* time
     if (!entry) return;
     entry->data.asAnimation.animationID = animationID;
     entry->data.asAnimation.time = *time;
-    if (Game_shouldAnimate()) (*time)++;
+}
+
+// Queue a callback that draws many sprites at one depth
+void SpriteQueue_addBatch(SpriteQueueBatchFn fn, int arg, int y) {
+    QueueEntry* entry = _queueAllocate(QueueEntryKind_batch, 0, y, 0);
+    if (!entry) return;
+    entry->data.asBatch.fn = fn;
+    entry->data.asBatch.arg = arg;
 }
 
 void SpriteQueue_render(void) {
+    PROFILE_BEGIN(spriteQueueRender);
+
     // Selection sort entries into order
     int smallestIndex;
     int smallestY;
@@ -324,31 +432,41 @@ void SpriteQueue_render(void) {
         } else if (entry->kind == QueueEntryKind_animation) {
             Animation_draw(entry->data.asAnimation.animationID, x, y,
                 &entry->data.asAnimation.time);
+        } else if (entry->kind == QueueEntryKind_batch) {
+            entry->data.asBatch.fn(entry->data.asBatch.arg);
         }
         _hasModColor = false;
     }
+    PROFILE_END(spriteQueueRender);
 }
 
+// Find or add an image, its texture isn't loaded until first drawn
 static SpriteImageID _findSpriteImage(const char* assetpath) {
     for (int i = 0; i < _spriteImageCount; i++) {
         if (strcmp(_spriteImages[i].assetpath, assetpath) == 0) return i;
     }
 
-    // if failed, load and try again
-    Loading_loadSpriteImage(assetpath);
+    if (_spriteImageCount == MAX_SPRITE_IMAGES) {
+        Log_error("Max sprite images exceeded");
+        return -1;
+    }
+    SpriteImageID id = _spriteImageCount++;
+    strncpy(_spriteImages[id].assetpath, assetpath, MAX_ASSETPATH_LENGTH - 1);
+    _spriteImages[id].texture = NULL;
+    return id;
+}
+
+// textures aren't stored in the game database, they load again when drawn
+static void _restoreSpriteImages(void) {
     for (int i = 0; i < _spriteImageCount; i++) {
-        if (strcmp(_spriteImages[i].assetpath, assetpath) == 0) return i;
+        _spriteImages[i].texture = NULL;
     }
-    return -1;
+    Residency_clear(ResidentKind_image);
 }
 
 static QueueEntry* _queueAllocate(QueueEntryKind kind, int x, int y, int z) {
     if (_queueEntryCount == MAX_QUEUE_ENTRIES) {
-        // todo: some kind of WARN_ONCE macro for this?
-        if (!_maxQueueWarningShown) {
-            Log_warn("max sprite queue sized reached");
-            _maxQueueWarningShown = true;
-        }
+        LOG_LIMITED(warn, graphics, "max sprite queue sized reached");
 
         return NULL;
     }
@@ -2,40 +2,100 @@
 
 // ===== [[ Defines ]] =====
 
-#define MAX_SECTIONS 256
-#define MAX_PROPERTIES 1024
-#define MAX_KEY_LENGTH 32
-#define MAX_VALUE_LENGTH 256
-#define MAX_LINE_LENGTH 256
+#define INI_BLOCK_SIZE 16384
+#define INI_INITIAL_SLOTS 256
+#define MAX_DIRECTIVE_LENGTH 128
 
 // ===== [[ Local Types ]] =====
 
+// Strings live in a chain of arena blocks that are reused after Ini_clear,
+// so pointers handed out stay valid until the next clear.
+typedef struct IniBlock {
+    struct IniBlock* next;
+    size_t size;
+    size_t used;
+    char data[];
+} IniBlock;
+
+// A slice of some source buffer, not null terminated
+typedef struct {
+    const char* data;
+    int length;
+} IniString;
+
 typedef struct {
-    char name[MAX_KEY_LENGTH];
+    const char* name; // null terminated copy
     int firstProperty;
 } IniSection;
 
+// Keys and values point into the buffer they were parsed from, which must
+// outlive the store. Sources are either arena copies of files, or archive
+// entries which stay mapped for the whole run.
 typedef struct {
-    char key[MAX_KEY_LENGTH];
-    char value[MAX_VALUE_LENGTH];
+    IniString key; // interned, so key.data identifies the key
+    IniString value;
+    const char* string; // null terminated value, made on first Ini_get
+    int section;
     int nextProperty;
 } IniProperty;
 
+// Open addressing hash table of indices, -1 for an empty slot
+typedef struct {
+    int* slots;
+    int slotCount; // power of two
+    int count;
+} IniTable;
+
+// Where @include directives in a buffer look for files
+typedef struct {
+    const char* name; // for messages
+    const char* directory; // NULL to include through Ini_readAsset
+    Archive archive; // archive the buffer came from, if any
+} IniSource;
+
 // ===== [[ Declarations ]] =====
 
 static bool _isWhitespace(char c);
-static IniSection* _findSection(const char* name);
-static IniSection* _createSection(const char* name);
-static bool _setProperty(IniSection* section,
-        const char* key, const char* value);
-static IniProperty* _findProperty(IniSection* section, const char* key);
+static IniString _trim(const char* begin, const char* end);
+static bool _parse(const char* data, size_t size, const IniSource* source);
+static void _parseLine(const char* begin, const char* end,
+        const IniSource* source, int* section);
+static void _include(const char* path, const IniSource* source);
+static char* _allocate(size_t size);
+static const char* _copy(const char* data, int length);
+static uint32_t _hashString(const char* data, int length);
+static uint32_t _hashProperty(int section, const char* key);
+static void _tableReserve(IniTable* table, int count);
+static void _tableClear(IniTable* table);
+static const char* _findString(const char* data, int length);
+static const char* _intern(const char* data, int length, bool copy);
+static int _findSection(const char* name, int length);
+static int _createSection(const char* name, int length);
+static bool _setProperty(int section, IniString key, IniString value);
+static int _findProperty(int section, const char* key);
 
 // ===== [[ Static Data ]] =====
 
+static IniBlock* _blocks;
+static IniBlock* _block; // block currently being filled
+
+static IniString* _strings;
+static int _stringCount;
+static int _stringCapacity;
+
+static IniSection* _sections;
 static int _sectionCount;
+static int _sectionCapacity;
+
+static IniProperty* _properties;
 static int _propertyCount;
-static IniSection _sections[MAX_SECTIONS];
-static IniProperty _properties[MAX_PROPERTIES];
+static int _propertyCapacity;
+
+static IniTable _stringTable; // interned string -> index into _strings
+static IniTable _sectionTable; // section name -> first section with it
+static IniTable _propertyTable; // (section, key) -> newest property
+
+static IniReadFn _readHook;
 
 // ===== [[ Implementations ]] =====
 
@@ -43,142 +103,88 @@ static IniProperty _properties[MAX_PROPERTIES];
 //       (this wont work with recursive calls to readFile)
 //       (split body of readFile into _processFile?)
 void Ini_clear(void) {
+    _stringCount = 0;
     _sectionCount = 0;
     _propertyCount = 0;
+    _tableClear(&_stringTable);
+    _tableClear(&_sectionTable);
+    _tableClear(&_propertyTable);
+    for (IniBlock* block = _blocks; block; block = block->next) {
+        block->used = 0;
+    }
+    _block = _blocks;
 }
 
 bool Ini_readFile(const char* filepath) {
-    FILE* f = fopen(filepath, "r");
+    FILE* f = fopen(filepath, "rb");
     if (f == NULL) {
         Log_error("Failed to open file %s", filepath);
         return false;
     }
 
-    IniSection* section = NULL;
-    char line[MAX_LINE_LENGTH];
-    while (!feof(f)) {
-        // todo: check if fgets failed
-        // todo: will this always be null terminated?
-        line[0] = 0;
-        fgets(line, MAX_LINE_LENGTH, f);
-
-        char* begin = line;
-        while (_isWhitespace(*begin)) begin++;
-
-        if (*begin == ';') {
-            // Skip comments
-            continue;
-        } else if (*begin == '[') {
-            // Extract section name
-            char* end = begin;
-            while (*end != ']' && *end) end++;
-            if (!*end) continue;
-            *end = 0;
-
-            // todo: check for invalid section name
-            //       or duplicate section
-
-            // Create section
-            section = _createSection(&begin[1]);
-            if (!section) {
-                return false;
-            }
-        } else if (*begin == '@') {
-            // Process special directives
-            char command[64] = "";
-            char argBuf[64] = "";
-            char* parts[] = { command, argBuf };
-            String_split(begin + 1, ' ', parts, 2, 64);
-            const char* arg = String_trimLocal(argBuf);
-            if (strcmp(command, "echo") == 0) {
-                Log_info("(from %s) %s", filepath, arg);
-            } else if (strcmp(command, "include") == 0) {
-                char expandPath[128];
-                // dirname of filepath
-                char* sep = strrchr(filepath, '/');
-                if (sep) {
-                    char dirpath[128];
-                    strncpy(dirpath, filepath, sep - filepath);
-					dirpath[sep - filepath] = 0;
-                    snprintf(expandPath, 128, "%s/%s", dirpath, arg);
-                } else {
-                    snprintf(expandPath, 128, "%s", arg);
-                }
-                if (!Ini_readFile(expandPath)) {
-                    Log_error("(included from %s)", filepath);
-                }
-            } else if (strcmp(command, "extend") == 0) {
-                IniSection* base = _findSection(arg);
-                if (base) {
-                    int propIndex = base->firstProperty;
-                    while (propIndex != -1) {
-                        IniProperty* property = &_properties[propIndex];
-                        _setProperty(section,
-                            property->key, property->value);
-                        propIndex = property->nextProperty;
-                    }
-                } else {
-                    Log_error("no such section '%s'", arg);
-                }
-            } else {
-                Log_warn("unknown ini directive %s", command);
-            }
-        } else {
-            // Extract property key and value
-            char* end = begin;
-            while (*end != '=' && *end) end++;
-            if (*end != '=') continue; // todo: error if not empty
-            char* begin_value = end + 1;
-            while (end > begin && _isWhitespace(end[-1])) end--;
-            while (_isWhitespace(*begin_value)) begin_value++;
-            char* end_value = begin_value;
-            char* begin_comment = strchr(begin_value, ';');
-            if (begin_comment) {
-                end_value = begin_comment;
-            } else {
-                while (*end_value) end_value++;
-            }
-            while (end_value > begin_value &&
-                    _isWhitespace(end_value[-1])) end_value--;
-            
-            // Create default section if needed
-            if (!section) {
-                section = _createSection("");
-            }
-
-            // todo: check property isn't duplicate
-
-            // Set property
-            *end = 0;
-            *end_value = 0;
-            _setProperty(section, begin, begin_value);
-        }
+    // the file is kept in the arena, properties point into it
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* data = _allocate(size > 0 ? size : 1);
+    size = fread(data, 1, size > 0 ? size : 0, f);
+    fclose(f);
+    if (_readHook) _readHook(filepath);
+
+    // dirname of filepath
+    char directory[MAX_DIRECTIVE_LENGTH] = ".";
+    const char* sep = strrchr(filepath, '/');
+    if (sep) {
+        snprintf(directory, sizeof(directory), "%.*s",
+                (int) (sep - filepath), filepath);
     }
-
-    return true;
+    IniSource source = {filepath, directory, NULL};
+    return _parse(data, size, &source);
 }
 
 bool Ini_readAsset(const char* assetpath) {
+    // tables packed into the asset archive parse straight from the mapping
+    if (Config_assetArchive[0]) {
+        Archive arc = Archive_get(Config_assetArchive);
+        if (arc && Archive_getSize(arc, assetpath)) {
+            size_t size;
+            const char* data = Archive_view(arc, assetpath, &size);
+            if (!data) return false; // corrupt, already logged
+            IniSource source = {assetpath, NULL, arc};
+            return _parse(data, size, &source);
+        }
+    }
+
     char filepath[256];
     snprintf(filepath, 256, "assets/%s", assetpath);
     return Ini_readFile(filepath);
 }
 
+// Parse a buffer without copying it, it must stay valid until Ini_clear.
+// @include loads through Ini_readAsset.
+bool Ini_readMemory(const char* data, size_t size) {
+    IniSource source = {"memory", NULL, NULL};
+    return _parse(data, size, &source);
+}
+
 bool Ini_writeFile(const char* filepath) {
     FILE* f = fopen(filepath, "w");
     if (!f) return false;
-    
+
     for (int i = 0; i < _sectionCount; i++) {
         IniSection* section = &_sections[i];
         if (section->name[0]) fprintf(f, "[%s]\n", section->name);
         int j = section->firstProperty;
         while (j != -1) {
             IniProperty* property = &_properties[j];
-            fprintf(f, "%s=%s\n", property->key, property->value);
+            fprintf(f, "%.*s=%.*s\n",
+                    property->key.length, property->key.data,
+                    property->value.length, property->value.data);
             j = property->nextProperty;
         }
     }
 
+    fclose(f);
     return true;
 }
 
@@ -188,90 +194,429 @@ const char* Ini_getSectionName(int index) {
 }
 
 const char* Ini_get(const char* section, const char* key) {
-    IniSection* iniSection = _findSection(section);
-    if (!iniSection) return NULL;
+    int iniSection = _findSection(section, strlen(section));
+    if (iniSection == -1) return NULL;
 
-    IniProperty* property = _findProperty(iniSection, key);
-    if (!property) return NULL;
+    int index = _findProperty(iniSection, key);
+    if (index == -1) return NULL;
 
-    return property->value;
+    IniProperty* property = &_properties[index];
+    if (!property->string) {
+        property->string = _copy(property->value.data, property->value.length);
+    }
+    return property->string;
+}
+
+// Get a value without null terminating it, valid until Ini_clear
+const char* Ini_getSlice(const char* section, const char* key, int* length) {
+    int iniSection = _findSection(section, strlen(section));
+    int index = iniSection == -1 ? -1 : _findProperty(iniSection, key);
+    if (index == -1) {
+        if (length) *length = 0;
+        return NULL;
+    }
+
+    IniProperty* property = &_properties[index];
+    if (length) *length = property->value.length;
+    return property->value.data;
 }
 
 bool Ini_set(const char* section, const char* key, const char* value) {
-    IniSection* iniSection = _findSection(section);
-    if (!iniSection) {
-        iniSection = _createSection(section);
-        if (!iniSection) {
-            return false;
-        }
+    int iniSection = _findSection(section, strlen(section));
+    if (iniSection == -1) {
+        iniSection = _createSection(section, strlen(section));
     }
 
     // todo: check value is valid
 
-    IniProperty* property = _findProperty(iniSection, key);
-    if (property) {
-        strncpy(property->value, value, MAX_VALUE_LENGTH);
+    IniString string = {_copy(value, strlen(value)), strlen(value)};
+    int property = _findProperty(iniSection, key);
+    if (property != -1) {
+        _properties[property].value = string;
+        _properties[property].string = string.data;
         return true;
     } else {
-        return _setProperty(iniSection, key, value);
+        IniString keyString = {_intern(key, strlen(key), true), strlen(key)};
+        return _setProperty(iniSection, keyString, string);
     }
 }
 
+void Ini_setReadHook(IniReadFn hook) {
+    _readHook = hook;
+}
+
+// Parse the given asset files repeatedly and time parsing and lookups
+void Ini_benchmark(const char* const* assetpaths, int count, int iterations) {
+    uint64_t freq = SDL_GetPerformanceFrequency();
+    double totalParse = 0, totalGet = 0;
+    for (int i = 0; i < count; i++) {
+        double parseMs = 0, getMs = 0;
+        int sections = 0, properties = 0;
+        for (int j = 0; j < iterations; j++) {
+            uint64_t t0 = SDL_GetPerformanceCounter();
+            Ini_readAsset(assetpaths[i]);
+            uint64_t t1 = SDL_GetPerformanceCounter();
+            // look up every property the way the loaders do
+            for (int k = 0; k < _propertyCount; k++) {
+                IniProperty* property = &_properties[k];
+                char key[MAX_DIRECTIVE_LENGTH];
+                snprintf(key, sizeof(key), "%.*s",
+                        property->key.length, property->key.data);
+                if (!Ini_get(_sections[property->section].name, key)) {
+                    Log_error("ini lookup failed");
+                }
+            }
+            uint64_t t2 = SDL_GetPerformanceCounter();
+            parseMs += (t1 - t0) * 1000.0 / freq;
+            getMs += (t2 - t1) * 1000.0 / freq;
+            sections = _sectionCount;
+            properties = _propertyCount;
+            Ini_clear();
+        }
+        printf("%-20s %4d sections %5d properties  parse %8.4fms  get %8.4fms\n",
+                assetpaths[i], sections, properties,
+                parseMs / iterations, getMs / iterations);
+        totalParse += parseMs / iterations;
+        totalGet += getMs / iterations;
+    }
+    printf("%-20s %38s  parse %8.4fms  get %8.4fms\n",
+            "total", "", totalParse, totalGet);
+}
+
 static bool _isWhitespace(char c) {
-    return c == ' ' || c == '\t' || c == '\n';
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
 }
 
-static IniSection* _findSection(const char* name) {
-    for (int i = 0; i < _sectionCount; i++) {
-        if (strcmp(_sections[i].name, name) == 0) {
-            return &_sections[i];
+static IniString _trim(const char* begin, const char* end) {
+    while (begin < end && _isWhitespace(*begin)) begin++;
+    while (end > begin && _isWhitespace(end[-1])) end--;
+    IniString result = {begin, (int) (end - begin)};
+    return result;
+}
+
+static bool _parse(const char* data, size_t size, const IniSource* source) {
+    const char* end = data + size;
+    const char* line = data;
+    int section = -1;
+    while (line < end) {
+        const char* lineEnd = memchr(line, '\n', end - line);
+        if (!lineEnd) lineEnd = end;
+        _parseLine(line, lineEnd, source, &section);
+        line = lineEnd + 1;
+    }
+    return true;
+}
+
+static void _parseLine(const char* begin, const char* end,
+        const IniSource* source, int* section) {
+    while (begin < end && _isWhitespace(*begin)) begin++;
+    if (begin == end) return;
+
+    if (*begin == ';') {
+        // Skip comments
+        return;
+    } else if (*begin == '[') {
+        // Extract section name
+        const char* close = memchr(begin, ']', end - begin);
+        if (!close) return;
+
+        // todo: check for invalid section name
+        //       or duplicate section
+
+        // Create section
+        *section = _createSection(begin + 1, close - begin - 1);
+    } else if (*begin == '@') {
+        // Process special directives
+        const char* space = memchr(begin, ' ', end - begin);
+        if (!space) space = end;
+        IniString command = _trim(begin + 1, space);
+        IniString argString = _trim(space, end);
+        char arg[MAX_DIRECTIVE_LENGTH];
+        snprintf(arg, sizeof(arg), "%.*s", argString.length, argString.data);
+        if (command.length == 4 && memcmp(command.data, "echo", 4) == 0) {
+            Log_info("(from %s) %s", source->name, arg);
+        } else if (command.length == 7 && memcmp(command.data, "include", 7) == 0) {
+            _include(arg, source);
+        } else if (command.length == 6 && memcmp(command.data, "extend", 6) == 0) {
+            int base = _findSection(arg, strlen(arg));
+            if (base != -1) {
+                int propIndex = _sections[base].firstProperty;
+                while (propIndex != -1) {
+                    IniProperty* property = &_properties[propIndex];
+                    _setProperty(*section, property->key, property->value);
+                    propIndex = property->nextProperty;
+                }
+            } else {
+                Log_error("no such section '%s'", arg);
+            }
+        } else {
+            Log_warn("unknown ini directive %.*s", command.length, command.data);
+        }
+    } else {
+        // Extract property key and value
+        const char* equals = memchr(begin, '=', end - begin);
+        if (!equals) return; // todo: error if not empty
+        const char* comment = memchr(equals, ';', end - equals);
+        IniString key = _trim(begin, equals);
+        IniString value = _trim(equals + 1, comment ? comment : end);
+
+        // Create default section if needed
+        if (*section == -1) {
+            *section = _createSection("", 0);
+        }
+
+        // todo: check property isn't duplicate
+
+        // Set property
+        key.data = _intern(key.data, key.length, false);
+        _setProperty(*section, key, value);
+    }
+}
+
+static void _include(const char* path, const IniSource* source) {
+    bool found = false;
+    if (source->archive && Archive_getSize(source->archive, path)) {
+        // includes resolve against the archive the including file is in
+        size_t size;
+        const char* data = Archive_view(source->archive, path, &size);
+        IniSource included = {path, NULL, source->archive};
+        found = data && _parse(data, size, &included);
+    } else if (source->directory) {
+        char expandPath[MAX_DIRECTIVE_LENGTH * 2];
+        snprintf(expandPath, sizeof(expandPath), "%s/%s",
+                source->directory, path);
+        found = Ini_readFile(expandPath);
+    } else {
+        found = Ini_readAsset(path);
+    }
+    if (!found) {
+        Log_error("(included from %s)", source->name);
+    }
+}
+
+static char* _allocate(size_t size) {
+    // move on to the next block with enough room, making one if needed
+    while (!_block || _block->used + size > _block->size) {
+        if (_block && _block->next && _block->next->used == 0 &&
+                _block->next->size >= size) {
+            _block = _block->next;
+            continue;
+        }
+        size_t blockSize = size > INI_BLOCK_SIZE ? size : INI_BLOCK_SIZE;
+        IniBlock* block = malloc(sizeof(IniBlock) + blockSize);
+        SDLAssert(block);
+        block->size = blockSize;
+        block->used = 0;
+        if (_block) {
+            block->next = _block->next;
+            _block->next = block;
+        } else {
+            block->next = NULL;
+            _blocks = block;
+        }
+        _block = block;
+    }
+
+    char* result = &_block->data[_block->used];
+    _block->used += size;
+    return result;
+}
+
+static const char* _copy(const char* data, int length) {
+    char* copy = _allocate(length + 1);
+    memcpy(copy, data, length);
+    copy[length] = 0;
+    return copy;
+}
+
+static uint32_t _hashString(const char* data, int length) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < length; i++) hash = (hash ^ (uint8_t) data[i]) * 16777619u;
+    return hash;
+}
+
+// keys are interned, so the pointer identifies the key
+static uint32_t _hashProperty(int section, const char* key) {
+    uint32_t hash = (uint32_t) (uintptr_t) key * 2654435761u;
+    return hash ^ ((uint32_t) section * 40503u);
+}
+
+// Make room for count entries at under half load. Rehashing needs to know
+// what each index refers to, so the tables are rebuilt from the arrays.
+static void _tableReserve(IniTable* table, int count) {
+    if (count * 2 <= table->slotCount) return;
+    int slotCount = table->slotCount ? table->slotCount : INI_INITIAL_SLOTS;
+    while (count * 2 > slotCount) slotCount *= 2;
+    table->slots = realloc(table->slots, sizeof(int) * slotCount);
+    SDLAssert(table->slots);
+    table->slotCount = slotCount;
+    memset(table->slots, -1, sizeof(int) * slotCount);
+    table->count = 0;
+
+    int mask = slotCount - 1;
+    if (table == &_stringTable) {
+        for (int i = 0; i < _stringCount; i++) {
+            uint32_t slot = _hashString(_strings[i].data, _strings[i].length) & mask;
+            while (table->slots[slot] != -1) slot = (slot + 1) & mask;
+            table->slots[slot] = i;
+            table->count++;
+        }
+    } else if (table == &_sectionTable) {
+        for (int i = 0; i < _sectionCount; i++) {
+            const char* name = _sections[i].name;
+            if (_findSection(name, strlen(name)) != -1) continue;
+            uint32_t slot = _hashString(name, strlen(name)) & mask;
+            while (table->slots[slot] != -1) slot = (slot + 1) & mask;
+            table->slots[slot] = i;
+            table->count++;
+        }
+    } else {
+        for (int i = 0; i < _propertyCount; i++) {
+            IniProperty* property = &_properties[i];
+            uint32_t slot = _hashProperty(property->section, property->key.data) & mask;
+            while (table->slots[slot] != -1 &&
+                    (_properties[table->slots[slot]].section != property->section ||
+                    _properties[table->slots[slot]].key.data != property->key.data)) {
+                slot = (slot + 1) & mask;
+            }
+            if (table->slots[slot] == -1) table->count++;
+            table->slots[slot] = i; // later properties replace earlier ones
         }
     }
+}
 
+static void _tableClear(IniTable* table) {
+    if (table->slots) memset(table->slots, -1, sizeof(int) * table->slotCount);
+    table->count = 0;
+}
+
+// Interned copy of a string, or NULL if it hasn't been seen
+static const char* _findString(const char* data, int length) {
+    if (!_stringTable.slotCount) return NULL;
+    int mask = _stringTable.slotCount - 1;
+    uint32_t slot = _hashString(data, length) & mask;
+    while (_stringTable.slots[slot] != -1) {
+        IniString* interned = &_strings[_stringTable.slots[slot]];
+        if (interned->length == length &&
+                memcmp(interned->data, data, length) == 0) {
+            return interned->data;
+        }
+        slot = (slot + 1) & mask;
+    }
     return NULL;
 }
 
-static IniSection* _createSection(const char* name) {
-    if (_sectionCount == MAX_SECTIONS) {
-        puts("Error: too many sections");
-        return NULL;
+// Intern a string, copying it into the arena if the source won't outlive
+// the store
+static const char* _intern(const char* data, int length, bool copy) {
+    const char* interned = _findString(data, length);
+    if (interned) return interned;
+
+    if (_stringCount == _stringCapacity) {
+        _stringCapacity = _stringCapacity ? _stringCapacity * 2 : INI_INITIAL_SLOTS;
+        _strings = realloc(_strings, sizeof(IniString) * _stringCapacity);
+        SDLAssert(_strings);
     }
+    if (copy) data = _copy(data, length);
+
+    _tableReserve(&_stringTable, _stringCount + 1);
+    int mask = _stringTable.slotCount - 1;
+    uint32_t slot = _hashString(data, length) & mask;
+    while (_stringTable.slots[slot] != -1) slot = (slot + 1) & mask;
+    _stringTable.slots[slot] = _stringCount;
+    _stringTable.count++;
+    _strings[_stringCount].data = data;
+    _strings[_stringCount].length = length;
+    _stringCount++;
+    return data;
+}
 
-    IniSection* section = &_sections[_sectionCount++];
-    strncpy(section->name, name, MAX_KEY_LENGTH);
+static int _findSection(const char* name, int length) {
+    if (!_sectionTable.slotCount) return -1;
+    int mask = _sectionTable.slotCount - 1;
+    uint32_t slot = _hashString(name, length) & mask;
+    while (_sectionTable.slots[slot] != -1) {
+        int index = _sectionTable.slots[slot];
+        const char* other = _sections[index].name;
+        if (strncmp(other, name, length) == 0 && !other[length]) return index;
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+static int _createSection(const char* name, int length) {
+    if (_sectionCount == _sectionCapacity) {
+        _sectionCapacity = _sectionCapacity ? _sectionCapacity * 2 : INI_INITIAL_SLOTS;
+        _sections = realloc(_sections, sizeof(IniSection) * _sectionCapacity);
+        SDLAssert(_sections);
+    }
+
+    int id = _sectionCount;
+    IniSection* section = &_sections[id];
+    section->name = _copy(name, length);
     section->firstProperty = -1;
 
-    return section;
+    // duplicate sections are kept, but lookups find the first one
+    if (_findSection(name, length) == -1) {
+        _tableReserve(&_sectionTable, _sectionTable.count + 1);
+        int mask = _sectionTable.slotCount - 1;
+        uint32_t slot = _hashString(name, length) & mask;
+        while (_sectionTable.slots[slot] != -1) slot = (slot + 1) & mask;
+        _sectionTable.slots[slot] = id;
+        _sectionTable.count++;
+    }
+    _sectionCount++;
+
+    return id;
 }
 
-static bool _setProperty(IniSection* section,
-        const char* key, const char* value) {
-    if (!section) return false;
-    if (_propertyCount == MAX_PROPERTIES) {
-        puts("Error: too many properties");
-        return false;
+// key must already be interned
+static bool _setProperty(int section, IniString key, IniString value) {
+    if (section == -1) return false;
+    if (_propertyCount == _propertyCapacity) {
+        _propertyCapacity = _propertyCapacity ? _propertyCapacity * 2 : INI_INITIAL_SLOTS;
+        _properties = realloc(_properties, sizeof(IniProperty) * _propertyCapacity);
+        SDLAssert(_properties);
     }
-    
+
+    // newest property with a key wins, as with the old list walk
+    _tableReserve(&_propertyTable, _propertyTable.count + 1);
+
     int id = _propertyCount++;
     IniProperty* property = &_properties[id];
-    strncpy(property->key, key, MAX_KEY_LENGTH);
-    strncpy(property->value, value, MAX_VALUE_LENGTH);
-    property->nextProperty = section->firstProperty;
-
-    section->firstProperty = id;
+    property->key = key;
+    property->value = value;
+    property->string = NULL;
+    property->section = section;
+    property->nextProperty = _sections[section].firstProperty;
+
+    _sections[section].firstProperty = id;
+
+    int mask = _propertyTable.slotCount - 1;
+    uint32_t slot = _hashProperty(section, key.data) & mask;
+    while (_propertyTable.slots[slot] != -1) {
+        IniProperty* other = &_properties[_propertyTable.slots[slot]];
+        if (other->section == section && other->key.data == key.data) break;
+        slot = (slot + 1) & mask;
+    }
+    if (_propertyTable.slots[slot] == -1) _propertyTable.count++;
+    _propertyTable.slots[slot] = id;
 
     return true;
 }
 
-static IniProperty* _findProperty(IniSection* section, const char* key) {
-    int propIndex = section->firstProperty;
-    while (propIndex != -1) {
-        IniProperty* property = &_properties[propIndex];
-        if (strcmp(property->key, key) == 0) {
-            return property;
+static int _findProperty(int section, const char* key) {
+    const char* interned = _findString(key, strlen(key));
+    if (!interned || !_propertyTable.slotCount) return -1;
+
+    int mask = _propertyTable.slotCount - 1;
+    uint32_t slot = _hashProperty(section, interned) & mask;
+    while (_propertyTable.slots[slot] != -1) {
+        IniProperty* property = &_properties[_propertyTable.slots[slot]];
+        if (property->section == section && property->key.data == interned) {
+            return _propertyTable.slots[slot];
         }
-        propIndex = property->nextProperty;
+        slot = (slot + 1) & mask;
     }
-
-    return NULL;
+    return -1;
 }
@@ -1,5 +1,8 @@
 #include "common.h"
 
+// Buttons are sampled once per tick from the keyboard and controller, or
+// from a replay when one is playing.
+
 // ===== [[ Local Types ]] =====
 
 typedef struct {
@@ -9,13 +12,18 @@ typedef struct {
 
 // ===== [[ Declarations ]] =====
 
+static void _sampleDevices(void);
+static void _getFrame(InputFrame* frame);
+static void _setFrame(const InputFrame* frame);
+
 // ===== [[ Static Data ]] =====
 
 static bool _currState[InputButton_COUNT];
 static bool _prevState[InputButton_COUNT];
 static float _duration[InputButton_COUNT];
-static int _lastClock;
 static InputSource _lastSource;
+static int16_t _axisX; // controller left stick, sampled with the buttons
+static int16_t _axisY;
 static SDL_GameController* _controller;
 static int _controllerID;
 static char* _textBuffer;
@@ -69,39 +77,29 @@ void Input_update(void) {
         _currState[i] = false;
     }
 
-    // check keyboard input
-    const uint8_t* keyStates = SDL_GetKeyboardState(NULL);
-    for (int i = 0; i < countof(_keyboardBindings); i++) {
-        if (keyStates[_keyboardBindings[i].code]) {
-            _currState[_keyboardBindings[i].button] = true;
-            _lastSource = InputSource_keyboard;
-        }
-    }
-
-    // check controller input
-    if (_controller) {
-        for (int i = 0; i < countof(_controllerBindings); i++) {
-            int code = _controllerBindings[i].code;
-            if (SDL_GameControllerGetButton(_controller, code)) {
-                _currState[_controllerBindings[i].button] = true;
-                _lastSource = InputSource_controller;
-            }
+    if (Replay_isPlaying()) {
+        InputFrame frame;
+        Replay_playInput(&frame);
+        _setFrame(&frame);
+    } else {
+        _sampleDevices();
+        if (Replay_isRecording()) {
+            InputFrame frame;
+            _getFrame(&frame);
+            Replay_recordInput(&frame);
         }
     }
 
-    // update button durations
-    int newClock = SDL_GetTicks();
-    float delta = (newClock - _lastClock) / 1000.0f;
+    // update button durations, one tick at a time
     for (int i = 0; i < InputButton_COUNT; i++) {
         if (_currState[i]) {
             if (_prevState[i]) {
-                _duration[i] += delta;
+                _duration[i] += 1.0f / TICK_RATE;
             } else {
                 _duration[i] = 0;
             }
         }
     }
-    _lastClock = newClock;
 }
 
 void Input_processEvent(SDL_Event* event) {
@@ -195,8 +193,7 @@ float Input_getMoveX(void) {
         if (Input_isDown(InputButton_right)) return 1;
         return 0;
     } else {
-        float raw = SDL_GameControllerGetAxis(_controller,
-            SDL_CONTROLLER_AXIS_LEFTX) / 32768.f;
+        float raw = _axisX / 32768.f;
         bool negative = raw < 0;
         if (negative) raw = -raw;
         // todo: deadzone calculation should probably consider
@@ -214,8 +211,7 @@ float Input_getMoveY(void) {
         if (Input_isDown(InputButton_down)) return 1;
         return 0;
     } else {
-        float raw = SDL_GameControllerGetAxis(_controller,
-            SDL_CONTROLLER_AXIS_LEFTY) / 32768.f;
+        float raw = _axisY / 32768.f;
         bool negative = raw < 0;
         if (negative) raw = -raw;
         float scaleFactor = 1 / (1 - Config_deadzoneY);
@@ -253,3 +249,49 @@ void Input_setTextInputPos(int x, int y) {
 const char* Input_getImeText(void) {
     return _imeBuffer;
 }
+
+static void _sampleDevices(void) {
+    // check keyboard input
+    const uint8_t* keyStates = SDL_GetKeyboardState(NULL);
+    for (int i = 0; i < countof(_keyboardBindings); i++) {
+        if (keyStates[_keyboardBindings[i].code]) {
+            _currState[_keyboardBindings[i].button] = true;
+            _lastSource = InputSource_keyboard;
+        }
+    }
+
+    // check controller input
+    if (_controller) {
+        for (int i = 0; i < countof(_controllerBindings); i++) {
+            int code = _controllerBindings[i].code;
+            if (SDL_GameControllerGetButton(_controller, code)) {
+                _currState[_controllerBindings[i].button] = true;
+                _lastSource = InputSource_controller;
+            }
+        }
+        _axisX = SDL_GameControllerGetAxis(_controller, SDL_CONTROLLER_AXIS_LEFTX);
+        _axisY = SDL_GameControllerGetAxis(_controller, SDL_CONTROLLER_AXIS_LEFTY);
+    } else {
+        _axisX = 0;
+        _axisY = 0;
+    }
+}
+
+static void _getFrame(InputFrame* frame) {
+    frame->buttons = 0;
+    for (int i = 0; i < InputButton_COUNT; i++) {
+        if (_currState[i]) frame->buttons |= 1 << i;
+    }
+    frame->axisX = _axisX;
+    frame->axisY = _axisY;
+    frame->source = _lastSource;
+}
+
+static void _setFrame(const InputFrame* frame) {
+    for (int i = 0; i < InputButton_COUNT; i++) {
+        _currState[i] = (frame->buttons >> i) & 1;
+    }
+    _axisX = frame->axisX;
+    _axisY = frame->axisY;
+    _lastSource = frame->source;
+}
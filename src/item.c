@@ -52,13 +52,25 @@ static InventorySlot _inventory[MAX_INVSLOTS];
 static LootTable _lootTables[MAX_LOOTTABLES];
 
 static int _itemCount;
+static NameIndex _itemIndex = NAME_INDEX(_items, _itemCount);
 static int _itemTypeCount;
+static NameIndex _itemTypeIndex = NAME_INDEX(_itemTypes, _itemTypeCount);
 static int _lootTableCount;
+static NameIndex _lootTableIndex = NAME_INDEX(_lootTables, _lootTableCount);
 static int _lootSpawnX;
 static int _lootSpawnY;
 
 // ===== [[ Implementations ]] =====
 
+void Item_registerTables(void) {
+    GameDb_addTable("items", _items, sizeof(Item),
+            &_itemCount, MAX_ITEMS, NULL);
+    GameDb_addTable("itemTypes", _itemTypes, sizeof(ItemType),
+            &_itemTypeCount, MAX_ITEMTYPES, NULL);
+    GameDb_addTable("lootTables", _lootTables, sizeof(LootTable),
+            &_lootTableCount, MAX_LOOTTABLES, NULL);
+}
+
 void Item_loadFrom(const char* assetpath) {
     Ini_readAsset(assetpath);
 
@@ -71,15 +83,25 @@ void Item_loadFrom(const char* assetpath) {
             return;
         }
 
-        Item* item = &_items[_itemCount++];
+        Item* item = &_items[NameIndex_add(&_itemIndex, name)];
+        memset(item, 0, sizeof(Item));
         strncpy(item->name, name, NAME_LENGTH);
 
-        const char* desc = Ini_get(name, "desc");
-        if (!desc) desc = "No description.";
-        strncpy(item->desc, desc, DESC_LENGTH);
-        const char* displayName = Ini_get(name, "name");
-        if (!displayName) displayName = item->name;
-        strncpy(item->displayName, displayName, NAME_LENGTH);
+        // copied straight out of the parsed file
+        int length;
+        const char* desc = Ini_getSlice(name, "desc", &length);
+        if (desc) {
+            snprintf(item->desc, DESC_LENGTH, "%.*s", length, desc);
+        } else {
+            strncpy(item->desc, "No description.", DESC_LENGTH);
+        }
+        const char* displayName = Ini_getSlice(name, "name", &length);
+        if (displayName) {
+            snprintf(item->displayName, NAME_LENGTH, "%.*s",
+                    length, displayName);
+        } else {
+            strncpy(item->displayName, item->name, NAME_LENGTH);
+        }
         
         // todo: a more stateful ini parser would probably be better
         //       like Ini_setSection(name); Ini_get("type");
@@ -137,7 +159,7 @@ void ItemType_loadFrom(const char* assetpath) {
             return;
         }
 
-        ItemType* itemType = &_itemTypes[_itemTypeCount++];
+        ItemType* itemType = &_itemTypes[NameIndex_add(&_itemTypeIndex, name)];
         strncpy(itemType->name, name, NAME_LENGTH);
         
         itemType->category = String_parseEnum(Ini_get(name, "category"),
@@ -149,9 +171,8 @@ void ItemType_loadFrom(const char* assetpath) {
 
 ItemID Item_find(const char* name) {
     if (!name) return -1;
-    for (int i = 0; i < _itemCount; i++) {
-        if (strcmp(_items[i].name, name) == 0) return i;
-    }
+    int id = NameIndex_find(&_itemIndex, name);
+    if (id != -1) return id;
     Log_warn("Cannot find item %s", name);
     return -1;
 }
@@ -256,9 +277,8 @@ int Item_getPrice(ItemID self) {
 
 ItemTypeID ItemType_find(const char* name) {
     if (!name) return -1;
-    for (int i = 0; i < _itemTypeCount; i++) {
-        if (strcmp(_itemTypes[i].name, name) == 0) return i;
-    }
+    int id = NameIndex_find(&_itemTypeIndex, name);
+    if (id != -1) return id;
     Log_warn("Cannot find item type %s", name);
     return -1;
 }
@@ -469,7 +489,7 @@ void LootTable_init(void) {
             return;
         }
 
-        LootTable* lootTable = &_lootTables[_lootTableCount++];
+        LootTable* lootTable = &_lootTables[NameIndex_add(&_lootTableIndex, name)];
         strncpy(lootTable->name, name, NAME_LENGTH);
         
         // Read array of items
@@ -502,9 +522,8 @@ void LootTable_init(void) {
 
 LootTableID LootTable_find(const char* name) {
     if (!name) return -1;
-    for (int i = 0; i < _lootTableCount; i++) {
-        if (strcmp(_lootTables[i].name, name) == 0) return i;
-    }
+    int id = NameIndex_find(&_lootTableIndex, name);
+    if (id != -1) return id;
     Log_warn("Cannot find loot table %s", name);
     return -1;
 }
@@ -514,7 +533,7 @@ void LootTable_drop(LootTableID self, int x, int y) {
     LootTable* lootTable = &_lootTables[self];
     
     for (int i = 0; i < lootTable->count; i++) {
-        int dice = rand() % 100;
+        int dice = Random_int(RandomStream_loot, 100);
         if (lootTable->chance[i] <= dice) continue;
 
         for (int j = 0; j < lootTable->quantity[i]; j++) {
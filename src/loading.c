@@ -1,40 +1,146 @@
 #include "common.h"
 //#include <SDL_mixer.h>
 
+// ===== [[ Defines ]] =====
+
+#define MAX_LOAD_JOBS 256
+#define MAX_LOAD_DEPENDENCIES 8
+#define MAX_LOAD_WORKERS 4
+#define LOAD_FRAME_BUDGET 12 // ms of main thread work per loading frame
+#define GAMEDB_FIRST_MODULE 2 // modules from here on are in the game database
+#define MAX_MODULE_FILES 64
+
 // ===== [[ Local Types ]] =====
 
 typedef void (*LoadingFn)(void);
+typedef void (*LoadingFromFn)(const char* assetpath);
+
+typedef enum {
+    LoadJobState_waiting, // for dependencies
+    LoadJobState_queued, // for a worker
+    LoadJobState_working,
+    LoadJobState_worked, // waiting for the main thread
+    LoadJobState_finishing,
+    LoadJobState_done
+} LoadJobState;
+
+typedef struct {
+    LoadJobFn work;
+    LoadJobFn finish;
+    void* data;
+    LoadJobState state;
+    int dependencyCount;
+    LoadJobID dependencies[MAX_LOAD_DEPENDENCIES];
+} LoadJob;
+
+typedef struct {
+    const char* name;
+    LoadingFn load;
+    LoadingFromFn loadFrom;
+    const char* assetpath;
+    const char* dependencies; // names of earlier modules, ';' separated
+    bool reloadable; // loader can run again, keeping ids of existing names
+} LoadingModule;
+
+// a file read by a module, to know what to reload when it changes
+typedef struct {
+    int module;
+    char assetpath[MAX_ASSETPATH_LENGTH];
+} ModuleFile;
+
+typedef struct imageJob {
+    char path[MAX_ASSETPATH_LENGTH * 2];
+    SDL_Surface* surface;
+    const uint8_t* blob; // pre-keyed pixels, uploaded as is
+    size_t blobSize;
+} ImageJob;
 
 // ===== [[ Declarations ]] =====
 
-static void _loadMisc(void);
-static void _loadSpriteImage(const char* name);
+static void _runModule(void* data);
+static void _addModuleJobs(int first, int last);
+static void _loadGameDb(void* unused);
+static void _noteModuleFile(const char* filepath);
+static bool _reloadModule(int module);
+static bool _runMainJob(void);
+static bool _runWork(void);
+static int _worker(void* unused);
+static void _startWorkers(void);
+static void _stopWorkers(void);
+static void _decodeImage(void* data);
+static SDL_Texture* _uploadImage(ImageJob* job);
+static SDL_Texture* _createRawTexture(const uint8_t* data, size_t size);
 
 // ===== [[ Static Data ]] =====
 
+// every table the loaders read, includes are pulled in by sprites.ini
+const char* const Loading_tableAssets[] = {
+    "sprites.ini", "animations.ini", "bfonts.ini", "music.ini",
+    "sounds.ini", "particles.ini", "attacks.ini", "statusfx.ini",
+    "itemtypes.ini", "items.ini", "loottables.ini", "recipes.ini",
+    "prefabs.ini", "villagers.ini", "quest_objs.ini", "quests.ini",
+    "dlgconvos.ini", "dlgtrigger.ini"
+};
+const int Loading_tableAssetCount = countof(Loading_tableAssets);
+
 static SDL_Texture* _texLoading;
 static SDL_Texture* _texLoading2;
 
-static LoadingFn _loadFns[] = {
-    Audio_startup,
-    Game_init,
-    _loadMisc
+// modules load on the main thread in this order, as soon as the modules
+// they look names up in are done
+static const LoadingModule _modules[] = {
+    {"audio", Audio_startup, NULL, NULL, "", false},
+    {"game", Game_init, NULL, NULL, "", false},
+    {"sprites", NULL, Sprite_loadFrom, "sprites.ini", "", true},
+    {"animations", NULL, Animation_loadFrom, "animations.ini", "sprites", true},
+    {"bfonts", BFont_load, NULL, NULL, "", false},
+    {"music", NULL, Music_loadFrom, "music.ini", "audio", false},
+    {"sounds", NULL, Sound_loadFrom, "sounds.ini", "audio", false},
+    {"particles", Particles_load, NULL, NULL, "sprites", true},
+    {"attacks", NULL, Attack_loadFrom, "attacks.ini", "sounds", true},
+    {"statusfx", StatusEffect_load, NULL, NULL, "sprites", true},
+    {"itemtypes", NULL, ItemType_loadFrom, "itemtypes.ini", "", true},
+    {"items", NULL, Item_loadFrom, "items.ini",
+        "sprites;attacks;itemtypes;statusfx", true},
+    {"loottables", LootTable_init, NULL, NULL, "items", true},
+    {"recipes", Recipe_load, NULL, NULL, "items", true},
+    {"prefabs", NULL, Entity_loadPrefabsFrom, "prefabs.ini",
+        "sprites;animations;sounds;particles;attacks;items;loottables", true},
+    {"villagers", Villager_load, NULL, NULL, "", true},
+    // quest progress and dialog triggers live in these tables
+    {"quests", Quest_load, NULL, NULL, "items;recipes;villagers", false},
+    {"dialog", Dialog_load, NULL, NULL, "items;recipes;villagers;quests", false},
 };
 
-static int _step;
+static LoadJob _jobs[MAX_LOAD_JOBS];
+static int _jobCount;
+static int _jobsDone;
+
+static bool _running; // loader threads are up, from the first loading state
+static bool _loading; // in the loading state, where Loading_update runs jobs
+static bool _quit;
+static SDL_mutex* _jobMutex;
+static SDL_cond* _jobCond;
+static SDL_Thread* _workers[MAX_LOAD_WORKERS];
+static int _workerCount;
+static Uint32 _startTicks;
+
+static ModuleFile _moduleFiles[MAX_MODULE_FILES];
+static int _moduleFileCount;
+static int _runningModule = -1; // module whose files are being noted
+static bool _tablesFromDb; // the loaders didn't run, so no files were noted
 
 // ===== [[ Implementations ]] =====
 
 void Loading_update(void) {
-    if (_step >= countof(_loadFns)) {
+    Uint32 start = SDL_GetTicks();
+    while (SDL_GetTicks() - start < LOAD_FRAME_BUDGET && _runMainJob()) {}
+
+    if (_jobsDone == _jobCount) {
+        Log_info("loaded %d jobs in %d ms", _jobCount,
+                (int) (SDL_GetTicks() - _startTicks));
         Main_stateChange(MainState_menu);
-        return;
     }
-
-    LoadingFn fn = _loadFns[_step];
-    fn();
-
-    _step++;
 }
 
 void Loading_render(void) {
@@ -53,84 +159,453 @@ void Loading_render(void) {
     //Draw_text(640 - 64 - 32 - 128, 480 - 64 + 4, "読み込み中");
 
     //float progress = SDL_GetTicks()*0.0004;
-    float progress = _step / (float) countof(_loadFns);
+    float progress = _jobCount ? _jobsDone / (float) _jobCount : 0;
 
-    progress = fmodf(progress, 1);
     SDL_SetRenderDrawColor(Main_renderer, 255, 255, 255 ,255);
     SDL_Rect progressOutline = {10, 480 - 10 - 8 - 4, 128+4, 8 + 4};
     SDL_RenderDrawRect(Main_renderer, &progressOutline);
     SDL_Rect progressBar = {10+2, 480 - 10 - 8 - 2, 128*progress, 8};
     SDL_RenderFillRect(Main_renderer, &progressBar);
+
+    // archive bytes unpacked so far
+    int bytesDone, bytesTotal;
+    Archive_getProgress(&bytesDone, &bytesTotal);
+    if (bytesTotal > 0) {
+        SDL_Rect bytesBar = {10, SCREEN_HEIGHT - 10 - 2,
+                (int) (128 * (bytesDone / (float) bytesTotal)), 2};
+        SDL_RenderFillRect(Main_renderer, &bytesBar);
+    }
     SDL_SetRenderDrawColor(Main_renderer, 0, 0, 0 ,255);
 }
 
 void Loading_enter(void) {
+    // unpack compressed archive entries in the background
+    Archive images = Archive_get("assets/images.arc");
+    Archive sounds = Archive_get("assets/sounds.arc");
+    if (images) Archive_unpackAsync(images);
+    if (sounds && !Config_disableAudio) Archive_unpackAsync(sounds);
+
     // load loadscreen assets immediately
     _texLoading = Loading_loadTexture("assets/images/loading.bmp");
     _texLoading2 = Loading_loadTexture("assets/images/loading2.bmp");
-    
-    // set initial configuration
-    _step = 0;
+
+    _startTicks = SDL_GetTicks();
+    _loading = true;
+    _jobCount = 0;
+    _jobsDone = 0;
+    // loader threads, leaving one core for the main thread. They stay
+    // after loading for residency loads
+    if (!_running) _startWorkers();
+
+    if (Config_gameDatabase[0]) {
+        // sounds are restored from the database, so it waits for audio
+        _addModuleJobs(0, GAMEDB_FIRST_MODULE);
+        LoadJobID db = Loading_addJob(NULL, _loadGameDb, NULL);
+        Loading_addDependency(db, 0);
+    } else {
+        _addModuleJobs(0, countof(_modules));
+    }
 }
 
 void Loading_leave(void) {
+    _loading = false;
     SDL_DestroyTexture(_texLoading);
     SDL_DestroyTexture(_texLoading2);
 }
 
+LoadJobID Loading_addJob(LoadJobFn work, LoadJobFn finish, void* data) {
+    if (!_running || _jobCount == MAX_LOAD_JOBS) {
+        if (_running) Log_warn("Max load jobs exceeded, loading inline");
+        if (work) work(data);
+        if (finish) finish(data);
+        return -1;
+    }
+
+    // only the main thread adds jobs, and workers only look at queued
+    // ones, so the new job can be filled in before taking the lock
+    LoadJobID id = _jobCount;
+    LoadJob* job = &_jobs[id];
+    job->work = work;
+    job->finish = finish;
+    job->data = data;
+    job->state = LoadJobState_waiting;
+    job->dependencyCount = 0;
+    SDL_LockMutex(_jobMutex);
+    _jobCount++;
+    SDL_UnlockMutex(_jobMutex);
+    return id;
+}
+
+void Loading_addDependency(LoadJobID self, LoadJobID dependency) {
+    if (self == -1 || dependency == -1) return;
+    LoadJob* job = &_jobs[self];
+    if (job->state != LoadJobState_waiting) {
+        Log_error("Cannot add dependency to a started load job");
+        return;
+    }
+    if (job->dependencyCount == MAX_LOAD_DEPENDENCIES) {
+        Log_error("Max load job dependencies exceeded");
+        return;
+    }
+    job->dependencies[job->dependencyCount++] = dependency;
+}
+
 SDL_Texture* Loading_loadTexture(const char* name) {
-    SDL_Surface* surface = SDL_LoadBMP(name);
+    ImageJob job = {0};
+    strncpy(job.path, name, sizeof(job.path) - 1);
+    _decodeImage(&job);
+    SDL_Texture* texture = _uploadImage(&job);
+    if (!texture) {
+        Log_flush();
+        abort();
+    }
+    return texture;
+}
+
+// Loading_loadTexture in two halves, the decode is safe on a loader thread
+DecodedImage Loading_decodeImage(const char* name) {
+    ImageJob* job = calloc(1, sizeof(ImageJob));
+    strncpy(job->path, name, sizeof(job->path) - 1);
+    _decodeImage(job);
+    return job;
+}
+
+// NULL if the image was missing or bad, that's already been logged
+SDL_Texture* Loading_uploadImage(DecodedImage image) {
+    SDL_Texture* texture = _uploadImage(image);
+    free(image);
+    return texture;
+}
+
+// Outside the loading state: finish the jobs whose work is done, or with
+// wait all of them, helping with the work meanwhile
+void Loading_finishJobs(bool wait) {
+    if (_loading || !_running) return;
+    while (_jobsDone < _jobCount) {
+        if (_runMainJob()) continue;
+        if (!wait) break;
+        if (!_runWork()) SDL_Delay(1);
+    }
+
+    SDL_LockMutex(_jobMutex);
+    if (_jobsDone == _jobCount) {
+        _jobCount = 0;
+        _jobsDone = 0;
+    }
+    SDL_UnlockMutex(_jobMutex);
+}
+
+static void _runModule(void* data) {
+    const LoadingModule* module = data;
+    _runningModule = module - _modules;
+    Ini_setReadHook(_noteModuleFile);
+    Trace_begin(module->name);
+    if (module->loadFrom) {
+        module->loadFrom(module->assetpath);
+    } else {
+        module->load();
+    }
+    Trace_end();
+    Ini_setReadHook(NULL);
+    _runningModule = -1;
+}
+
+static void _noteModuleFile(const char* filepath) {
+    // files come in as assets/<assetpath>
+    const char* assetpath = strncmp(filepath, "assets/", 7) == 0 ?
+            filepath + 7 : filepath;
+    for (int i = 0; i < _moduleFileCount; i++) {
+        if (_moduleFiles[i].module == _runningModule &&
+                strcmp(_moduleFiles[i].assetpath, assetpath) == 0) return;
+    }
+    if (_moduleFileCount == MAX_MODULE_FILES) {
+        Log_warn("Max module files exceeded, %s won't hot reload", assetpath);
+        return;
+    }
+    ModuleFile* file = &_moduleFiles[_moduleFileCount++];
+    file->module = _runningModule;
+    strncpy(file->assetpath, assetpath, MAX_ASSETPATH_LENGTH - 1);
+}
+
+// Called by the watcher when a file under assets/ changes
+void Loading_reloadAsset(const char* assetpath) {
+    Uint32 start = SDL_GetTicks();
+
+    if (strncmp(assetpath, "images/", 7) == 0) {
+        if (Sprite_reloadImage(assetpath + 7)) {
+            Log_info("reloaded %s in %d ms", assetpath,
+                    (int) (SDL_GetTicks() - start));
+        }
+        return;
+    }
+
+    if (strncmp(assetpath, "regions/", 8) == 0) {
+        // the region's entities go with it, the player stays
+        if (Main_getState() == MainState_game) {
+            Game_reloadRegion();
+            Log_info("reloaded %s in %d ms", assetpath,
+                    (int) (SDL_GetTicks() - start));
+        }
+        return;
+    }
+
+    bool found = false;
+    for (int i = 0; i < _moduleFileCount; i++) {
+        if (strcmp(_moduleFiles[i].assetpath, assetpath) != 0) continue;
+        found = true;
+        int module = _moduleFiles[i].module;
+        if (!_modules[module].reloadable) {
+            Log_info("%s changed, restart to load %s", assetpath,
+                    _modules[module].name);
+            continue;
+        }
+        if (_reloadModule(module)) {
+            Log_info("reloaded %s (%s) in %d ms", assetpath,
+                    _modules[module].name, (int) (SDL_GetTicks() - start));
+        }
+    }
+    if (!found && strstr(assetpath, ".ini")) {
+        if (_tablesFromDb) {
+            Log_info("%s changed, but tables are loaded from %s, so they "
+                    "don't hot reload", assetpath, Config_gameDatabase);
+        } else {
+            LOG_DEBUG(assets, "%s changed, but no module read it", assetpath);
+        }
+    }
+}
+
+// Run a module's loader again. Existing names keep their ids, so nothing
+// else needs to change. If the loader complains, the old tables are put
+// back rather than leaving them half loaded.
+static bool _reloadModule(int module) {
+    void* snapshot = GameDb_snapshot();
+    int issues = Log_getIssueCount();
+    _runModule((void*) &_modules[module]);
+    if (Log_getIssueCount() != issues) {
+        Log_warn("Reloading %s failed, keeping the old data",
+                _modules[module].name);
+        GameDb_restoreSnapshot(snapshot);
+        return false;
+    }
+    GameDb_freeSnapshot(snapshot);
+    return true;
+}
+
+void Loading_loadAll(void) {
+    for (int i = 0; i < (int) countof(_modules); i++) {
+        _runModule((void*) &_modules[i]);
+    }
+}
+
+// Add jobs for modules first to last - 1, modules before first are done
+static void _addModuleJobs(int first, int last) {
+    LoadJobID ids[countof(_modules)];
+    for (int i = first; i < last; i++) {
+        const LoadingModule* module = &_modules[i];
+        ids[i] = Loading_addJob(NULL, _runModule, (void*) module);
+
+        char dependencies[128];
+        strncpy(dependencies, module->dependencies, sizeof(dependencies) - 1);
+        dependencies[sizeof(dependencies) - 1] = 0;
+        for (char* name = strtok(dependencies, ";"); name;
+                name = strtok(NULL, ";")) {
+            int j = 0;
+            while (j < i && strcmp(_modules[j].name, name) != 0) j++;
+            if (j == i) {
+                Log_error("Unknown load module %s (needed by %s)",
+                        name, module->name);
+                continue;
+            }
+            if (j >= first) Loading_addDependency(ids[i], ids[j]);
+        }
+    }
+}
+
+static void _loadGameDb(void* unused) {
+    Trace_begin("GameDb_load");
+    bool loaded = GameDb_load(Config_gameDatabase);
+    Trace_end();
+    _tablesFromDb = loaded;
+    if (!loaded) {
+        _addModuleJobs(GAMEDB_FIRST_MODULE, countof(_modules));
+    }
+}
+
+// Queue jobs whose dependencies are done, then run the first job waiting
+// on the main thread. Returns false if there was nothing to run.
+static bool _runMainJob(void) {
+    LoadJob* next = NULL;
+    bool queued = false;
+
+    SDL_LockMutex(_jobMutex);
+    for (int i = 0; i < _jobCount; i++) {
+        LoadJob* job = &_jobs[i];
+        if (job->state == LoadJobState_waiting) {
+            bool ready = true;
+            for (int j = 0; j < job->dependencyCount; j++) {
+                if (_jobs[job->dependencies[j]].state != LoadJobState_done) {
+                    ready = false;
+                }
+            }
+            if (!ready) continue;
+            if (job->work) {
+                job->state = LoadJobState_queued;
+                queued = true;
+            } else {
+                job->state = LoadJobState_worked;
+            }
+        }
+        if (job->state == LoadJobState_worked && !next) next = job;
+    }
+    if (queued) SDL_CondBroadcast(_jobCond);
+    if (next) next->state = LoadJobState_finishing;
+    SDL_UnlockMutex(_jobMutex);
+
+    if (!next) return false;
+    if (next->finish) next->finish(next->data);
+
+    SDL_LockMutex(_jobMutex);
+    next->state = LoadJobState_done;
+    _jobsDone++;
+    SDL_UnlockMutex(_jobMutex);
+    return true;
+}
+
+// Do the work of the first queued job. Returns false if none were queued.
+static bool _runWork(void) {
+    SDL_LockMutex(_jobMutex);
+    LoadJob* job = NULL;
+    for (int i = 0; i < _jobCount; i++) {
+        if (_jobs[i].state == LoadJobState_queued) {
+            job = &_jobs[i];
+            break;
+        }
+    }
+    if (job) job->state = LoadJobState_working;
+    SDL_UnlockMutex(_jobMutex);
+    if (!job) return false;
+
+    job->work(job->data);
+    SDL_LockMutex(_jobMutex);
+    job->state = LoadJobState_worked;
+    SDL_UnlockMutex(_jobMutex);
+    return true;
+}
+
+static int _worker(void* unused) {
+    Trace_setThreadName("loader");
+    SDL_LockMutex(_jobMutex);
+    while (!_quit) {
+        SDL_UnlockMutex(_jobMutex);
+        bool worked = _runWork();
+        SDL_LockMutex(_jobMutex);
+        if (!worked && !_quit) SDL_CondWait(_jobCond, _jobMutex);
+    }
+    SDL_UnlockMutex(_jobMutex);
+    return 0;
+}
+
+static void _startWorkers(void) {
+    _quit = false;
+    _jobMutex = SDL_CreateMutex();
+    _jobCond = SDL_CreateCond();
+    SDLAssert(_jobMutex && _jobCond);
+    int count = SDL_GetCPUCount() - 1;
+    if (count < 1) count = 1;
+    if (count > MAX_LOAD_WORKERS) count = MAX_LOAD_WORKERS;
+    _workerCount = 0;
+    for (int i = 0; i < count; i++) {
+        SDL_Thread* thread = SDL_CreateThread(_worker, "loader", NULL);
+        if (!thread) break;
+        _workers[_workerCount++] = thread;
+    }
+    _running = true;
+    atexit(_stopWorkers);
+}
+
+static void _stopWorkers(void) {
+    SDL_LockMutex(_jobMutex);
+    _quit = true;
+    SDL_CondBroadcast(_jobCond);
+    SDL_UnlockMutex(_jobMutex);
+    for (int i = 0; i < _workerCount; i++) {
+        SDL_WaitThread(_workers[i], NULL);
+    }
+    _workerCount = 0;
+    _running = false;
+}
+
+// Read and decode an image into a surface ready for upload.
+// Safe to run on a loader thread.
+static void _decodeImage(void* data) {
+    ImageJob* job = data;
+    Trace_begin("decodeImage");
+    SDL_Surface* surface = SDL_LoadBMP(job->path);
     if (surface == NULL) {
-//        Log_debug("searching archive for %s", name);
-        Archive arc = Archive_open("assets/images.arc");
-        if (arc) {
-            const char* filename = strrchr(name, '/')+1;
-            size_t size = Archive_getSize(arc, filename);
-            uint8_t *data = malloc(size);
-            Archive_read(arc, filename, size, data);
-            surface = SDL_LoadBMP_RW(SDL_RWFromConstMem(data, (int) size), 1);
-            Archive_close(arc);
-            free(data);
+//        Log_debug("searching archive for %s", job->path);
+        Archive arc = Archive_get("assets/images.arc");
+        const char* sep = strrchr(job->path, '/');
+        const char* filename = sep ? sep + 1 : job->path;
+        size_t size;
+        const uint8_t* bytes = arc ? Archive_view(arc, filename, &size) : NULL;
+        // pre-keyed pixels written by arctool.py --rgba
+        if (bytes && size >= 16 && memcmp(bytes, "TEX0", 4) == 0) {
+            job->blob = bytes;
+            job->blobSize = size;
+            Trace_end();
+            return;
+        }
+        if (bytes) {
+            surface = SDL_LoadBMP_RW(SDL_RWFromConstMem(bytes, (int) size), 1);
         }
     }
     if (!surface) {
-        Log_error("file not found: '%s'", name);
-        abort();
+        Trace_end();
+        return;
     }
 
+    // key out black and convert here, so the upload doesn't have to
     SDL_SetColorKey(surface, SDL_TRUE, SDL_MapRGB(surface->format, 0, 0, 0));
+    job->surface = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+    if (job->surface) {
+        SDL_FreeSurface(surface);
+    } else {
+        job->surface = surface;
+    }
+    Trace_end();
+}
+
+static SDL_Texture* _uploadImage(ImageJob* job) {
+    if (job->blob) return _createRawTexture(job->blob, job->blobSize);
+    if (!job->surface) {
+        Log_error("file not found: '%s'", job->path);
+        return NULL;
+    }
 
-    SDL_Texture* tex = SDL_CreateTextureFromSurface(Main_renderer, surface);
+    SDL_Texture* tex = SDL_CreateTextureFromSurface(Main_renderer, job->surface);
     SDLAssert(tex);
 
-    SDL_FreeSurface(surface);
+    SDL_FreeSurface(job->surface);
+    job->surface = NULL;
 
     return tex;
 }
 
-void Loading_loadSpriteImage(const char* name) {
-    char filepath[256];
-    snprintf(filepath, 256, "assets/images/%s", name);
-//	Log_debug("### name '%s' fpath '%s'", name, filepath);
-    SDL_Texture* result = Loading_loadTexture(filepath);
-    Sprite_setSpriteImage(name, result);
-}
-
-static void _loadMisc(void) {
-    Sprite_loadFrom("sprites.ini");
-    Animation_loadFrom("animations.ini");
-    BFont_load();
-    Music_loadFrom("music.ini");
-    Sound_loadFrom("sounds.ini");
-    Particles_load();
-    Attack_loadFrom("attacks.ini");
-    StatusEffect_load();
-    ItemType_loadFrom("itemtypes.ini");
-    Item_loadFrom("items.ini");
-    LootTable_init();
-    Recipe_load();
-    Entity_loadPrefabsFrom("prefabs.ini");
-    Villager_load();
-    Quest_load();
-    Dialog_load();
+// Create a texture from a 'TEX0' blob: 16 byte header (magic, width,
+// height, pad) followed by RGBA8888 pixels
+static SDL_Texture* _createRawTexture(const uint8_t* data, size_t size) {
+    int32_t w, h;
+    memcpy(&w, data + 4, 4);
+    memcpy(&h, data + 8, 4);
+    if (w <= 0 || h <= 0 || size < 16 + (size_t) w * h * 4) {
+        Log_error("bad texture blob (%dx%d, %d bytes)", w, h, (int) size);
+        return NULL;
+    }
+
+    SDL_Texture* tex = SDL_CreateTexture(Main_renderer,
+            SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STATIC, w, h);
+    SDLAssert(tex);
+    SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
+    SDLAssert(SDL_UpdateTexture(tex, NULL, data + 16, w * 4) == 0);
+    return tex;
 }
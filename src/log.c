@@ -0,0 +1,249 @@
+#include "common.h"
+
+// Logging that doesn't stall the caller on the terminal. Messages are
+// formatted straight into a fixed ring of lines, which any thread can add
+// to without locking, and a background thread prints them. A full ring
+// drops lines rather than waiting. Each category has its own level, from
+// the [Log] section of config.ini, and the same line repeated back to back
+// is printed once with a count. Before Log_startup and after
+// Log_shutdown lines are printed right away.
+
+// ===== [[ Defines ]] =====
+
+#define LOG_RING_SIZE 256 // lines, power of two
+#define LOG_LINE_LENGTH 256
+#define LOG_DRAIN_MS 50 // longest a line waits when nothing wakes the thread
+
+// ===== [[ Local Types ]] =====
+
+typedef struct {
+    SDL_atomic_t sequence; // position it's ready to be written at, or +1 read
+    LogLevel level;
+    LogCategory category;
+    char text[LOG_LINE_LENGTH];
+} LogLine;
+
+// ===== [[ Declarations ]] =====
+
+static void _writeV(LogLevel level, LogCategory category,
+        const char* format, va_list args);
+static int _drain(void* unused);
+static void _drainLines(void);
+static void _print(LogLevel level, const char* text);
+static void _flushRepeats(void);
+
+// ===== [[ Static Data ]] =====
+
+static const char* _categoryNames[LogCategory_COUNT] = {
+    [LogCategory_general] = "general",
+    [LogCategory_assets] = "assets",
+    [LogCategory_audio] = "audio",
+    [LogCategory_entity] = "entity",
+    [LogCategory_graphics] = "graphics",
+};
+
+static const char* _levelFormats[] = {
+    [LogLevel_error] = "\x1b[31merror: %s\x1b[0m\n",
+    [LogLevel_warn] = "\x1b[33mwarn: %s\x1b[0m\n",
+    [LogLevel_info] = "info: %s\x1b[0m\n",
+    [LogLevel_debug] = "\x1b[32mdebug: %s\x1b[0m\n",
+};
+
+static int _levels[LogCategory_COUNT] = {
+    LogLevel_info, LogLevel_info, LogLevel_info, LogLevel_info, LogLevel_info
+};
+
+static LogLine _ring[LOG_RING_SIZE];
+static SDL_atomic_t _head; // next position to claim
+static int _tail; // next position to print, drain thread only
+static SDL_atomic_t _printed; // positions done, for Log_flush
+static SDL_atomic_t _dropped;
+static SDL_atomic_t _issueCount; // errors and warnings logged so far
+static SDL_atomic_t _running;
+static SDL_Thread* _thread;
+static SDL_sem* _wake;
+
+// last line printed, to fold repeats
+static char _lastText[LOG_LINE_LENGTH];
+static LogLevel _lastLevel;
+static int _repeats;
+
+// ===== [[ Implementations ]] =====
+
+void Log_startup(void) {
+    for (int i = 0; i < LogCategory_COUNT; i++) {
+        Log_setLevel(i, Config_logLevels[i]);
+    }
+    if (_thread) return;
+    for (int i = 0; i < LOG_RING_SIZE; i++) {
+        SDL_AtomicSet(&_ring[i].sequence, i);
+    }
+    _wake = SDL_CreateSemaphore(0);
+    SDL_AtomicSet(&_running, 1);
+    _thread = SDL_CreateThread(_drain, "log", NULL);
+    if (!_thread) {
+        SDL_AtomicSet(&_running, 0);
+        Log_warn("Logging on the calling thread: %s", SDL_GetError());
+        return;
+    }
+    // menus quit with exit(), so print whatever's left from there too
+    atexit(Log_shutdown);
+}
+
+void Log_shutdown(void) {
+    if (!_thread) return;
+    SDL_AtomicSet(&_running, 0);
+    SDL_SemPost(_wake);
+    SDL_WaitThread(_thread, NULL);
+    _thread = NULL;
+    SDL_DestroySemaphore(_wake);
+    _wake = NULL;
+}
+
+// Wait until every line logged so far has been printed
+void Log_flush(void) {
+    if (!SDL_AtomicGet(&_running)) return;
+    int head = SDL_AtomicGet(&_head);
+    SDL_SemPost(_wake);
+    while (SDL_AtomicGet(&_running) && SDL_AtomicGet(&_printed) - head < 0) {
+        SDL_Delay(1);
+    }
+}
+
+void Log_setLevel(LogCategory category, int level) {
+    _levels[category] = level;
+}
+
+const char* Log_getCategoryName(LogCategory category) {
+    return _categoryNames[category];
+}
+
+void Log_write(LogLevel level, LogCategory category, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    _writeV(level, category, format, args);
+    va_end(args);
+}
+
+void Log_error(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    _writeV(LogLevel_error, LogCategory_general, format, args);
+    va_end(args);
+}
+
+void Log_warn(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    _writeV(LogLevel_warn, LogCategory_general, format, args);
+    va_end(args);
+}
+
+void Log_info(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    _writeV(LogLevel_info, LogCategory_general, format, args);
+    va_end(args);
+}
+
+int Log_getIssueCount(void) {
+    return SDL_AtomicGet(&_issueCount);
+}
+
+// For LOG_LIMITED: true at most once per LOG_LIMIT_MS from each call site,
+// with how many were held back since the last one
+bool Log_limit(LogLimit* limit, int* suppressed) {
+    int now = (int) SDL_GetTicks();
+    int next = SDL_AtomicGet(&limit->next);
+    if ((limit->started && now - next < 0) ||
+            !SDL_AtomicCAS(&limit->next, next, now + LOG_LIMIT_MS)) {
+        SDL_AtomicIncRef(&limit->suppressed);
+        return false;
+    }
+    limit->started = true;
+    *suppressed = SDL_AtomicSet(&limit->suppressed, 0);
+    return true;
+}
+
+static void _writeV(LogLevel level, LogCategory category,
+        const char* format, va_list args) {
+    if (level <= LogLevel_warn) SDL_AtomicIncRef(&_issueCount);
+    if (level > _levels[category]) return;
+
+    if (!SDL_AtomicGet(&_running)) {
+        char text[LOG_LINE_LENGTH];
+        vsnprintf(text, sizeof(text), format, args);
+        _print(level, text);
+        return;
+    }
+
+    // claim the next line, unless the drain thread hasn't got to it yet
+    int position = SDL_AtomicGet(&_head);
+    LogLine* line;
+    for (;;) {
+        line = &_ring[position & (LOG_RING_SIZE - 1)];
+        int difference = SDL_AtomicGet(&line->sequence) - position;
+        if (difference == 0) {
+            if (SDL_AtomicCAS(&_head, position, position + 1)) break;
+        } else if (difference < 0) {
+            SDL_AtomicIncRef(&_dropped);
+            return;
+        }
+        position = SDL_AtomicGet(&_head);
+    }
+
+    line->level = level;
+    line->category = category;
+    vsnprintf(line->text, sizeof(line->text), format, args);
+    SDL_AtomicSet(&line->sequence, position + 1);
+    // errors are printed right away, they often come just before a crash
+    if (level == LogLevel_error) SDL_SemPost(_wake);
+}
+
+static int _drain(void* unused) {
+    Trace_setThreadName("log");
+    while (SDL_AtomicGet(&_running)) {
+        SDL_SemWaitTimeout(_wake, LOG_DRAIN_MS);
+        _drainLines();
+        fflush(stderr);
+    }
+    _drainLines();
+    _flushRepeats();
+    fflush(stderr);
+    return 0;
+}
+
+static void _drainLines(void) {
+    for (;;) {
+        LogLine* line = &_ring[_tail & (LOG_RING_SIZE - 1)];
+        if (SDL_AtomicGet(&line->sequence) != _tail + 1) break;
+        _print(line->level, line->text);
+        SDL_AtomicSet(&line->sequence, _tail + LOG_RING_SIZE);
+        _tail++;
+        SDL_AtomicSet(&_printed, _tail);
+    }
+
+    int dropped = SDL_AtomicSet(&_dropped, 0);
+    if (dropped) {
+        char text[64];
+        snprintf(text, sizeof(text), "%d log lines dropped", dropped);
+        _print(LogLevel_warn, text);
+    }
+}
+
+static void _print(LogLevel level, const char* text) {
+    if (level == _lastLevel && strcmp(text, _lastText) == 0) {
+        _repeats++;
+        return;
+    }
+    _flushRepeats();
+    fprintf(stderr, _levelFormats[level], text);
+    _lastLevel = level;
+    strncpy(_lastText, text, LOG_LINE_LENGTH - 1);
+}
+
+static void _flushRepeats(void) {
+    if (_repeats == 0) return;
+    fprintf(stderr, "  (repeated %d times)\n", _repeats);
+    _repeats = 0;
+}
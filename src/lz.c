@@ -0,0 +1,66 @@
+#include "common.h"
+
+// LZ4-style block codec, used for compressed archive entries. They're
+// compressed by script/arctool.py.
+// A block is a series of sequences:
+//   token: high nibble literal count, low nibble match length - 4
+//          (15 means more length bytes follow, each added until one < 255)
+//   literals
+//   2 byte little endian match offset (omitted for the final sequence)
+// The final sequence is literals only.
+
+// ===== [[ Defines ]] =====
+
+#define LZ_MIN_MATCH 4
+
+// ===== [[ Implementations ]] =====
+
+// Decompress src into dst, returns bytes written or -1 if malformed
+int Lz_decompress(const uint8_t* src, int srcSize, uint8_t* dst, int dstSize) {
+    const uint8_t* ip = src;
+    const uint8_t* ipEnd = src + srcSize;
+    uint8_t* op = dst;
+    uint8_t* opEnd = dst + dstSize;
+
+    while (ip < ipEnd) {
+        int token = *ip++;
+
+        // literals
+        int length = token >> 4;
+        if (length == 15) {
+            int b;
+            do {
+                if (ip >= ipEnd) return -1;
+                b = *ip++;
+                length += b;
+            } while (b == 255);
+        }
+        if (length > ipEnd - ip || length > opEnd - op) return -1;
+        memcpy(op, ip, length);
+        ip += length;
+        op += length;
+        if (ip == ipEnd) break; // final sequence
+
+        // match
+        if (ipEnd - ip < 2) return -1;
+        int offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op - dst) return -1;
+        length = (token & 15);
+        if (length == 15) {
+            int b;
+            do {
+                if (ip >= ipEnd) return -1;
+                b = *ip++;
+                length += b;
+            } while (b == 255);
+        }
+        length += LZ_MIN_MATCH;
+        if (length > opEnd - op) return -1;
+        const uint8_t* match = op - offset;
+        for (int i = 0; i < length; i++) op[i] = match[i]; // may overlap
+        op += length;
+    }
+
+    return (int) (op - dst);
+}
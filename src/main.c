@@ -3,12 +3,16 @@
 #include "SDL_video.h"
 #include "common.h"
 
+#define MAX_TICKS_PER_FRAME 4 // any further behind and the game slows down
+
 SDL_Window* Main_window;
 SDL_Renderer* Main_renderer;
 
 static bool _running;
-static int _lastUpdateTime;
-static int _lastDelta;
+static uint64_t _lastFrameTime;
+static uint64_t _tickAccumulator; // performance counter time not yet ticked
+static float _tickAlpha = 1;
+static int _tick;
 //static FC_Font* _fntDetail;
 //static FC_Font* _fntMedium;
 //static FC_Font* _fntJapanese;
@@ -18,13 +22,46 @@ static MainState _state2;
 static MainState _nextState2;
 static bool _stateLeaving;
 
+// headless benchmark mode (--headless)
+static bool _headless;
+static int _headlessFrames = 600;
+static int _headlessFrame;
+static const char* _headlessDumpDir;
+static bool _headlessHash;
+static SDL_Surface* _headlessSurface;
+static int _benchIni; // iterations for --bench-ini, 0 if not benchmarking
+static const char* _compileDb; // output path for --compile-db
+static const char* _tracePath; // chrome trace output for --trace
+static const char* _frameCsvPath; // frame stats output for --frame-csv
+static const char* _recordPath; // input recording for --record
+static const char* _replayPath; // input to play back for --replay
+static double* _headlessUpdateMs;
+static double* _headlessRenderMs;
+static BFontID _perfFont = -1; // for the perf overlay, once fonts are loaded
+
+static void _parseArgs(int argc, char* argv[]);
 static void _startup(void);
 static void _shutdown(void);
-static void _beginUpdate(void);
+static int _beginFrame(void);
+static double _elapsedMs(uint64_t from, uint64_t to);
+static void _headlessEndFrame(uint64_t beginUpdate, uint64_t beginDraw, uint64_t endDraw);
+static void _headlessReport(void);
 
 // Main entry point to the application
 int main(int argc, char* argv[]) {
     Config_load();
+    Log_startup();
+#ifdef HELMSGARD_BENCH
+    // helmsgard_bench shares everything but the main loop
+    return Bench_main(argc, argv);
+#endif
+    _parseArgs(argc, argv);
+    if (_tracePath) Trace_startup(_tracePath);
+
+    if (_benchIni) {
+        Ini_benchmark(Loading_tableAssets, Loading_tableAssetCount, _benchIni);
+        return 0;
+    }
 
     SDL_version ver;
     SDL_GetVersion(&ver);
@@ -32,6 +69,23 @@ int main(int argc, char* argv[]) {
 
     _startup();
 
+    if (_compileDb) {
+        // load every table from INI and refuse to write if anything's wrong
+        Loading_loadAll();
+        int issues = Log_getIssueCount();
+        bool written = false;
+        if (issues) {
+            Log_error("%d problems found, not writing %s", issues, _compileDb);
+        } else {
+            written = GameDb_write(_compileDb);
+        }
+        _shutdown();
+        Trace_shutdown();
+        return written ? 0 : 1;
+    }
+
+    if (Config_hotReload) Watch_startup();
+    Pacer_startup();
     _nextState2 = MainState_loading;
 
     /*_fntDetail = FC_CreateFont();
@@ -48,8 +102,10 @@ int main(int argc, char* argv[]) {
 
 
     while (_running) {
-        _beginUpdate();
-        Input_update();
+        int ticks = _beginFrame();
+        Trace_begin("frame");
+        // tables are only reloaded once the loader is done with them
+        if (_state2 != MainState_loading) Watch_update();
 
         Draw_setColor(Color_black);
         SDL_SetRenderTarget(Main_renderer, fbo);
@@ -57,14 +113,24 @@ int main(int argc, char* argv[]) {
         Draw_setColor(Color_white);
         //Draw_setFont(_fntDetail);
 
+        // headless runs and replays skip the menu and go straight into the
+        // game, so they start from the same place every time
+        if ((_headless || _recordPath || _replayPath) &&
+                _nextState2 == MainState_menu) {
+            _nextState2 = MainState_game;
+        }
+
         if (_nextState2 != MainState_invalid) {
             // Exit previous state
             switch (_state2) {
                 case MainState_invalid: break;
-                case MainState_loading: Loading_leave(); break;
+                case MainState_loading:
+                    Loading_leave();
+                    _perfFont = BFont_find("dialog");
+                    break;
                 case MainState_title: Title_leave(); break;
                 case MainState_menu: Menu_leave(); break;
-                case MainState_game: Game_leave(); break;
+                case MainState_game: Game_leave(); Replay_end(); break;
                 case MainState_editor: Editor_leave(); break;
             }
 
@@ -74,24 +140,46 @@ int main(int argc, char* argv[]) {
                 case MainState_loading: Loading_enter(); break;
                 case MainState_title: Title_enter(); break;
                 case MainState_menu: Menu_enter(); break;
-                case MainState_game: Game_enter(); break;
+                case MainState_game: Replay_begin(); Game_enter(); break;
                 case MainState_editor: Editor_enter(); break;
             }
 
             _state2 = _nextState2;
             _nextState2 = MainState_invalid;
-        }
 
-        uint32_t timeBeginUpdate = SDL_GetTicks();
-        switch (_state2) {
-            case MainState_invalid: break;
-            case MainState_loading: Loading_update(); break;
-            case MainState_title: Title_update(); break;
-            case MainState_menu: Menu_update(); break;
-            case MainState_game: Game_update(); break;
-            case MainState_editor: Editor_update(); break;
+            // don't catch up on the time spent entering the state
+            _lastFrameTime = SDL_GetPerformanceCounter();
+            _tickAccumulator = 0;
+            ticks = 1;
         }
-        uint32_t timeBeginDraw = SDL_GetTicks();
+        // the loader works to its own time budget, once a frame
+        if (_state2 == MainState_loading) ticks = 1;
+
+        uint64_t perfBeginUpdate = SDL_GetPerformanceCounter();
+        Trace_begin("update");
+        // stop ticking once a state change is asked for
+        for (int i = 0; i < ticks && _nextState2 == MainState_invalid; i++) {
+            if (Replay_isFinished()) {
+                _running = false;
+                break;
+            }
+            _tick++;
+            Input_update();
+            Residency_update();
+            Audio_update();
+            switch (_state2) {
+                case MainState_invalid: break;
+                case MainState_loading: Loading_update(); break;
+                case MainState_title: Title_update(); break;
+                case MainState_menu: Menu_update(); break;
+                case MainState_game: Game_update(); break;
+                case MainState_editor: Editor_update(); break;
+            }
+            Replay_endTick();
+        }
+        Trace_end();
+        uint64_t perfBeginDraw = SDL_GetPerformanceCounter();
+        Trace_begin("render");
         switch (_state2) {
             case MainState_invalid: break;
             case MainState_loading: Loading_render(); break;
@@ -100,47 +188,63 @@ int main(int argc, char* argv[]) {
             case MainState_game: Game_render(); break;
             case MainState_editor: Editor_render(); break;
         }
-        uint32_t timeEndDraw = SDL_GetTicks();
+        Trace_end();
+        uint64_t perfEndDraw = SDL_GetPerformanceCounter();
 
         if (Config_showPerf) {
-            const char* stateName = "(error)";
-            switch (_state2) {
-                case MainState_invalid: stateName = "(none)"; break;
-                case MainState_loading: stateName = "Loading"; break;
-                case MainState_title: stateName = "Title"; break;
-                case MainState_menu: stateName = "Menu"; break;
-                case MainState_game: stateName = "Game"; break;
-                case MainState_editor: stateName = "Editor"; break;
-            }
-            /*FC_Draw(_fntDetail, Main_renderer, 10, 10,
-                    "total  %2dms\nupdate  %2dms\nrender  %2dms\nstate %-8s",
-                    _lastDelta, timeBeginDraw - timeBeginUpdate,
-                    timeEndDraw - timeBeginDraw, stateName);*/
+			int textHits, textMisses, textTextures;
+			BFont_getCacheStats(&textHits, &textMisses, &textTextures);
 			BFont_drawText(
-				BFont_find("dialog"), SCREEN_WIDTH - 60, 10,
-				"total  %2dms\nupdate  %dms\nrender  %dms",
-				_lastDelta, timeBeginDraw - timeBeginUpdate,
-				timeEndDraw - timeBeginDraw
+				_perfFont, SCREEN_WIDTH - 60, 10,
+				"text  %d/%d/%d\nassets  %dK",
+				textHits, textMisses, textTextures,
+				Residency_getLoadedBytes() / 1024
 			);
+			Pacer_drawOverlay(_perfFont);
+#ifdef HELMSGARD_PROFILE
+			Profile_drawOverlay(_perfFont);
+#endif
         }
 
         SDL_SetRenderTarget(Main_renderer, NULL);
         SDL_RenderCopy(Main_renderer, fbo, NULL, NULL);
+        Trace_begin("present");
         SDL_RenderPresent(Main_renderer);
+        Trace_end();
+        Trace_end();
+        uint64_t perfEndPresent = SDL_GetPerformanceCounter();
+
+        Pacer_addSample(FramePhase_update, perfBeginUpdate, perfBeginDraw);
+        Pacer_addSample(FramePhase_render, perfBeginDraw, perfEndDraw);
+        Pacer_addSample(FramePhase_present, perfEndDraw, perfEndPresent);
+#ifdef HELMSGARD_PROFILE
+        Profile_endFrame();
+#endif
+
+        if (_headless && _state2 == MainState_game) {
+            _headlessEndFrame(perfBeginUpdate, perfBeginDraw, perfEndDraw);
+        }
     }
 
+    if (_headless) _headlessReport();
+    if (_frameCsvPath) Pacer_writeCsv(_frameCsvPath);
+    Replay_shutdown();
+
     /*FC_FreeFont(_fntDetail);
     FC_FreeFont(_fntMedium);
     FC_FreeFont(_fntJapanese);*/
 
     _shutdown();
-    return 0;
+    Trace_shutdown();
+    // a replay that didn't match what was recorded fails the run
+    return Replay_getMismatchCount() ? 1 : 0;
 }
 
 // Prints an error and exits if cond is false
 void SDLAssert(bool cond) {
     if (!cond) {
         Log_error("(SDL) %s", SDL_GetError());
+        Log_flush();
         abort();
     }
 }
@@ -152,8 +256,88 @@ void Main_stateChange(MainState nextState) {
     if (nextState != _state2) _nextState2 = nextState;
 }
 
+MainState Main_getState(void) {
+    return _state2;
+}
+
+int Main_getTick(void) {
+    return _tick;
+}
+
+float Main_getTickAlpha(void) {
+    return _tickAlpha;
+}
+
+// Parse command line options
+static void _parseArgs(int argc, char* argv[]) {
+    bool framesGiven = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            _headless = true;
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            _headlessFrames = String_parseInt(argv[++i], _headlessFrames);
+            framesGiven = true;
+        } else if (strcmp(argv[i], "--dump-ppm") == 0 && i + 1 < argc) {
+            _headlessDumpDir = argv[++i];
+        } else if (strcmp(argv[i], "--hash") == 0) {
+            _headlessHash = true;
+        } else if (strcmp(argv[i], "--compile-db") == 0 && i + 1 < argc) {
+            _compileDb = argv[++i];
+            _headless = true;
+        } else if (strcmp(argv[i], "--bench-ini") == 0 && i + 1 < argc) {
+            _benchIni = String_parseInt(argv[++i], 100);
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            _tracePath = argv[++i];
+        } else if (strcmp(argv[i], "--frame-csv") == 0 && i + 1 < argc) {
+            _frameCsvPath = argv[++i];
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            Random_seed(strtoull(argv[++i], NULL, 0));
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            _recordPath = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            _replayPath = argv[++i];
+        } else {
+            Log_warn("unknown argument '%s'", argv[i]);
+        }
+    }
+
+    if (_replayPath) {
+        int replayTicks = Replay_startPlayback(_replayPath);
+        if (replayTicks < 0) exit(1);
+        // headless replays run the whole recording unless told otherwise
+        if (_headless && !framesGiven) _headlessFrames = replayTicks;
+    } else if (_recordPath) {
+        if (!Replay_startRecording(_recordPath)) exit(1);
+    }
+
+    if (_headless) {
+        if (_headlessFrames < 1) _headlessFrames = 1;
+        Config_disableAudio = true;
+        Config_showPerf = false;
+        Config_hotReload = false;
+        Config_frameRate = 0;
+    }
+}
+
 // Initialize SDL
 static void _startup(void) {
+    if (_headless) {
+        // render into a plain surface, no window or vsync
+        if (SDL_Init(SDL_INIT_EVENTS) < 0) {
+            Log_error("(SDL) %s", SDL_GetError());
+            exit(1);
+        }
+        _headlessSurface = SDL_CreateRGBSurfaceWithFormat(0,
+                SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+        SDLAssert(_headlessSurface);
+        Main_renderer = SDL_CreateSoftwareRenderer(_headlessSurface);
+        SDLAssert(Main_renderer);
+        _headlessUpdateMs = calloc(_headlessFrames, sizeof(double));
+        _headlessRenderMs = calloc(_headlessFrames, sizeof(double));
+        _running = true;
+        return;
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO |
             SDL_INIT_GAMECONTROLLER |
             SDL_INIT_AUDIO) < 0) {
@@ -191,8 +375,8 @@ static void _startup(void) {
         SDL_SetWindowFullscreen(Main_window, SDL_WINDOW_FULLSCREEN);
     }
 
-    Main_renderer = SDL_CreateRenderer(
-            Main_window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    Main_renderer = SDL_CreateRenderer(Main_window, -1, SDL_RENDERER_ACCELERATED |
+            (Config_vsync ? SDL_RENDERER_PRESENTVSYNC : 0));
     SDLAssert(Main_renderer);
 
     _running = true;
@@ -200,20 +384,43 @@ static void _startup(void) {
 
 // Shutdown SDL
 static void _shutdown(void) {
+    Watch_shutdown();
+    Archive_closeAll();
     SDL_DestroyRenderer(Main_renderer);
-    SDL_DestroyWindow(Main_window);
+    if (Main_window) SDL_DestroyWindow(Main_window);
+    if (_headlessSurface) SDL_FreeSurface(_headlessSurface);
+    free(_headlessUpdateMs);
+    free(_headlessRenderMs);
 
     //TTF_Quit();
     SDL_Quit();
 }
 
-// Framerate limiter & event polling
-static void _beginUpdate(void) {
-    _lastDelta = SDL_GetTicks() - _lastUpdateTime;
-    while (SDL_GetTicks() - _lastUpdateTime < 16) {
-        SDL_Delay(1);
+// Frame pacing and event polling, returns how many fixed ticks are due
+// this frame. Rendering runs at the display rate or Config_frameRate, the
+// game at TICK_RATE.
+static int _beginFrame(void) {
+    Pacer_beginFrame();
+    uint64_t now = SDL_GetPerformanceCounter();
+    uint64_t tickLength = SDL_GetPerformanceFrequency() / TICK_RATE;
+    if (!_lastFrameTime) _lastFrameTime = now - tickLength;
+    _tickAccumulator += now - _lastFrameTime;
+    _lastFrameTime = now;
+
+    int ticks = 1;
+    if (_headless) {
+        // exactly one tick per frame, so runs are repeatable
+        _tickAccumulator = 0;
+        _tickAlpha = 1;
+    } else {
+        ticks = (int) (_tickAccumulator / tickLength);
+        if (ticks > MAX_TICKS_PER_FRAME) {
+            ticks = MAX_TICKS_PER_FRAME;
+            _tickAccumulator = ticks * tickLength;
+        }
+        _tickAccumulator -= ticks * tickLength;
+        _tickAlpha = _tickAccumulator / (float) tickLength;
     }
-    _lastUpdateTime = SDL_GetTicks();
 
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
@@ -233,9 +440,82 @@ static void _beginUpdate(void) {
                 case SDLK_F4:
                 // TODO impl
                 break;
+
+#ifdef HELMSGARD_PROFILE
+                // Change how the profiler table is sorted with F5
+                case SDLK_F5:
+                Profile_cycleSort();
+                break;
+#endif
             }
             break;
         }
         Input_processEvent(&event);
     }
+    return ticks;
+}
+
+static double _elapsedMs(uint64_t from, uint64_t to) {
+    return (to - from) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+// FNV-1a over the visible pixels of the headless surface
+static uint32_t _headlessHashFrame(void) {
+    uint32_t hash = 2166136261u;
+    for (int y = 0; y < _headlessSurface->h; y++) {
+        const uint8_t* row = (const uint8_t*) _headlessSurface->pixels + y * _headlessSurface->pitch;
+        for (int i = 0; i < _headlessSurface->w * 4; i++) {
+            hash = (hash ^ row[i]) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+static void _headlessDumpFrame(void) {
+    char filepath[256];
+    snprintf(filepath, 256, "%s/frame%05d.ppm", _headlessDumpDir, _headlessFrame);
+    FILE* f = fopen(filepath, "wb");
+    if (!f) {
+        Log_error("cannot write %s", filepath);
+        return;
+    }
+    fprintf(f, "P6\n%d %d\n255\n", _headlessSurface->w, _headlessSurface->h);
+    for (int y = 0; y < _headlessSurface->h; y++) {
+        const uint32_t* row = (const uint32_t*) ((const uint8_t*) _headlessSurface->pixels + y * _headlessSurface->pitch);
+        for (int x = 0; x < _headlessSurface->w; x++) {
+            uint8_t rgb[3] = { row[x] >> 16, row[x] >> 8, row[x] };
+            fwrite(rgb, 1, 3, f);
+        }
+    }
+    fclose(f);
+}
+
+// Record timings for a headless game frame, stop once enough have run
+static void _headlessEndFrame(uint64_t beginUpdate, uint64_t beginDraw, uint64_t endDraw) {
+    double updateMs = _elapsedMs(beginUpdate, beginDraw);
+    double renderMs = _elapsedMs(beginDraw, endDraw);
+    _headlessUpdateMs[_headlessFrame] = updateMs;
+    _headlessRenderMs[_headlessFrame] = renderMs;
+
+    if (_headlessHash) {
+        printf("%d %.3f %.3f %08x\n", _headlessFrame, updateMs, renderMs, _headlessHashFrame());
+    } else {
+        printf("%d %.3f %.3f\n", _headlessFrame, updateMs, renderMs);
+    }
+    if (_headlessDumpDir) _headlessDumpFrame();
+
+    if (++_headlessFrame >= _headlessFrames) _running = false;
+}
+
+static void _headlessReport(void) {
+    double sums[2] = {0}, maxs[2] = {0};
+    for (int i = 0; i < _headlessFrame; i++) {
+        sums[0] += _headlessUpdateMs[i];
+        sums[1] += _headlessRenderMs[i];
+        if (_headlessUpdateMs[i] > maxs[0]) maxs[0] = _headlessUpdateMs[i];
+        if (_headlessRenderMs[i] > maxs[1]) maxs[1] = _headlessRenderMs[i];
+    }
+    int n = _headlessFrame > 0 ? _headlessFrame : 1;
+    Log_info("headless: %d frames, update avg %.3fms max %.3fms, render avg %.3fms max %.3fms",
+            _headlessFrame, sums[0] / n, maxs[0], sums[1] / n, maxs[1]);
 }
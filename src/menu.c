@@ -24,6 +24,8 @@ static void _enterMain(void);
 static void _enterOptions(void);
 static void _enterSaveSelect(void);
 
+static void _resolveIds(void);
+
 // ===== [[ Static Data ]] =====
 
 static MenuSubState _subState;
@@ -31,6 +33,22 @@ static int _sel;
 static int _xc;
 static int _xt;
 
+// assets used every frame, looked up once on entering the menu
+static struct {
+    bool resolved;
+    SpriteID btn;
+    SpriteID btnActive;
+    SpriteID hand;
+    SpriteID bgtiles;
+    SpriteID title;
+    SpriteID txtPlay;
+    SpriteID txtCredits;
+    SpriteID txtQuit;
+    BFontID dialog;
+    SoundID click;
+    SoundID ok;
+} _ids;
+
 // ===== [[ Implementations ]] =====
 
 void Menu_enter(void) {
@@ -38,6 +56,7 @@ void Menu_enter(void) {
     _sel = 0;
     _xc = -100;
     _xt = 50;
+    _resolveIds();
     Music_play(Music_find("menu"));
 }
 
@@ -63,13 +82,17 @@ void Menu_render(void) {
 }
 
 static void _updateMain(void) {
+    // slide the buttons in
+    if (_xt - _xc < 2) _xc = _xt;
+    else _xc += ceil((_xt - _xc) * 0.1f);
+
     if (Input_isPressed(InputButton_up) && _sel > 0) {
         _sel--; 
-        Sound_play(Sound_find("click3"));
+        Sound_play(_ids.click);
     }
     if (Input_isPressed(InputButton_down) && _sel < 2) {
         _sel++;
-        Sound_play(Sound_find("click3"));
+        Sound_play(_ids.click);
     }
 
     if (Input_isReleased(InputButton_accept) ||
@@ -77,7 +100,7 @@ static void _updateMain(void) {
         switch (_sel) {
             case 0:
                 Main_stateChange(MainState_game);
-                Sound_play(Sound_find("titleok")); break;
+                Sound_play(_ids.ok); break;
             case 1: _enterOptions(); break;
             case 2: exit(0); break;
             default: break;
@@ -93,27 +116,27 @@ static void _updateOptions(void) {
 static void _updateSaveSelect(void) {
     if (Input_isPressed(InputButton_up) && _sel > 0) {
         _sel--;
-        Sound_play(Sound_find("click3"));
+        Sound_play(_ids.click);
     }
     if (Input_isPressed(InputButton_down) && _sel < 2) {
         _sel++;
-        Sound_play(Sound_find("click3"));
+        Sound_play(_ids.click);
     }
 
     if (Input_isReleased(InputButton_accept) ||
 		Input_isKeyboard() && Input_isPressed(InputButton_interact)) {
         Main_stateChange(MainState_game);
-        Sound_play(Sound_find("titleok"));
+        Sound_play(_ids.ok);
     }
     if (Input_isReleased(InputButton_back)) _enterMain();
 }
 
 static void _renderMain(void) {
-    SpriteID spr_btn = Sprite_find("menu/btn");
-    SpriteID spr_btnActive = Sprite_find("menu/btnActive");
-    SpriteID spr_hand = Sprite_find("menu/hand");
-    SpriteID spr_bgtiles = Sprite_find("menu/bgtiles");
-    SpriteID spr_title = Sprite_find("menu/title");
+    SpriteID spr_btn = _ids.btn;
+    SpriteID spr_btnActive = _ids.btnActive;
+    SpriteID spr_hand = _ids.hand;
+    SpriteID spr_bgtiles = _ids.bgtiles;
+    SpriteID spr_title = _ids.title;
 
     int time = (SDL_GetTicks() / 20) % 32;
     for (int x = 0; x < 20; x++) {
@@ -124,8 +147,6 @@ static void _renderMain(void) {
     
     Sprite_draw(spr_title, (SCREEN_WIDTH-212)/2, 60);
 
-    if (_xt - _xc < 2) _xc = _xt;
-    else _xc += ceil((_xt - _xc) * 0.1f);
     int x = _xc;
 
     Sprite_draw(_sel==0?spr_btnActive:spr_btn, x, 140);
@@ -139,11 +160,11 @@ static void _renderMain(void) {
     // Draw_text(100, 140+64, "  Exit");
     Draw_setColor(Color_white);
 
-    Sprite_draw(Sprite_find("menu/txt_play"), x+21, 147);
-    Sprite_draw(Sprite_find("menu/txt_credits"), x+13, 147+32);
-    Sprite_draw(Sprite_find("menu/txt_quit"), x+23, 147+64);
+    Sprite_draw(_ids.txtPlay, x+21, 147);
+    Sprite_draw(_ids.txtCredits, x+13, 147+32);
+    Sprite_draw(_ids.txtQuit, x+23, 147+64);
 
-    BFont_drawTextExt(BFont_find("dialog"),
+    BFont_drawTextExt(_ids.dialog,
         SCREEN_WIDTH/2-100, SCREEN_HEIGHT-24, 200, 0.5f, "GDS O-WEEK 2021 DEMO");
 }
 
@@ -151,8 +172,7 @@ static void _renderOptions(void) {
     // Draw_text(100, 100, "Options");
     // Draw_text(100, 140, "not implemented...");
 
-    SpriteID spr_bgtiles = Sprite_find("menu/bgtiles");
-    SpriteID spr_title = Sprite_find("menu/title");
+    SpriteID spr_bgtiles = _ids.bgtiles;
 
     int time = (SDL_GetTicks() / 20) % 32;
     for (int x = 0; x < 20; x++) {
@@ -161,7 +181,7 @@ static void _renderOptions(void) {
         }
     }
     
-    BFontID bf = BFont_find("dialog");
+    BFontID bf = _ids.dialog;
 
     BFont_drawTextExt(bf, 50, 50, SCREEN_WIDTH-100, 0,
         "Made by Matthew Turner. Copyright 2020-23.\n"
@@ -200,3 +220,19 @@ static void _enterSaveSelect(void) {
     _sel = 0;
     _subState = MenuSubState_saveSelect;
 }
+
+static void _resolveIds(void) {
+    if (_ids.resolved) return;
+    _ids.resolved = true;
+    _ids.btn = Sprite_find("menu/btn");
+    _ids.btnActive = Sprite_find("menu/btnActive");
+    _ids.hand = Sprite_find("menu/hand");
+    _ids.bgtiles = Sprite_find("menu/bgtiles");
+    _ids.title = Sprite_find("menu/title");
+    _ids.txtPlay = Sprite_find("menu/txt_play");
+    _ids.txtCredits = Sprite_find("menu/txt_credits");
+    _ids.txtQuit = Sprite_find("menu/txt_quit");
+    _ids.dialog = BFont_find("dialog");
+    _ids.click = Sound_find("click3");
+    _ids.ok = Sound_find("titleok");
+}
@@ -0,0 +1,122 @@
+#include "common.h"
+
+// Hashed name -> id lookup for the asset tables. An index points at the
+// name field of the first element of a table plus the table's count, and
+// picks up new elements lazily on the next find, so loaders don't need to
+// register anything. NameIndex_invalidateAll throws every index away for
+// when tables are replaced wholesale (game database, reloads).
+
+// ===== [[ Defines ]] =====
+
+#define NAME_INDEX_MIN_SLOTS 64
+
+// ===== [[ Declarations ]] =====
+
+static uint32_t _hash(const char* name);
+static void _reset(NameIndex* self);
+static void _grow(NameIndex* self);
+static void _insert(NameIndex* self, int id, uint32_t hash);
+static void _update(NameIndex* self);
+
+// ===== [[ Static Data ]] =====
+
+static int _generation = 1;
+
+// ===== [[ Implementations ]] =====
+
+static uint32_t _hash(const char* name) {
+    uint32_t hash = 2166136261u;
+    for (const char* c = name; *c; c++) {
+        hash = (hash ^ (uint8_t) *c) * 16777619u;
+    }
+    return hash;
+}
+
+int NameIndex_find(NameIndex* self, const char* name) {
+    _update(self);
+    if (!self->slotCount) return -1;
+    uint32_t hash = _hash(name);
+    int mask = self->slotCount - 1;
+    for (int slot = hash & mask; self->slots[slot] != -1; slot = (slot + 1) & mask) {
+        int id = self->slots[slot];
+        if (self->hashes[slot] == hash &&
+                strcmp(self->names + (size_t) id * self->stride, name) == 0) {
+            return id;
+        }
+    }
+    return -1;
+}
+
+// Id of the element called name, or a new one on the end of the table.
+// Loaders get their elements through this so reloading a table keeps the
+// ids of names it already had.
+int NameIndex_add(NameIndex* self, const char* name) {
+    int id = NameIndex_find(self, name);
+    return id != -1 ? id : (*self->count)++;
+}
+
+void NameIndex_invalidateAll(void) {
+    _generation++;
+}
+
+static void _reset(NameIndex* self) {
+    self->indexed = 0;
+    self->used = 0;
+    if (self->slotCount) memset(self->slots, -1, sizeof(int) * self->slotCount);
+    self->generation = _generation;
+}
+
+static void _grow(NameIndex* self) {
+    int oldCount = self->slotCount;
+    int* oldSlots = self->slots;
+    uint32_t* oldHashes = self->hashes;
+
+    self->slotCount = oldCount ? oldCount * 2 : NAME_INDEX_MIN_SLOTS;
+    self->slots = malloc(sizeof(int) * self->slotCount);
+    self->hashes = malloc(sizeof(uint32_t) * self->slotCount);
+    SDLAssert(self->slots && self->hashes);
+    memset(self->slots, -1, sizeof(int) * self->slotCount);
+    self->used = 0;
+    for (int i = 0; i < oldCount; i++) {
+        if (oldSlots[i] != -1) _insert(self, oldSlots[i], oldHashes[i]);
+    }
+    free(oldSlots);
+    free(oldHashes);
+}
+
+static void _insert(NameIndex* self, int id, uint32_t hash) {
+    int mask = self->slotCount - 1;
+    int slot = hash & mask;
+    while (self->slots[slot] != -1) slot = (slot + 1) & mask;
+    self->slots[slot] = id;
+    self->hashes[slot] = hash;
+    self->used++;
+}
+
+// index elements added since the last find
+static void _update(NameIndex* self) {
+    if (self->generation != _generation || *self->count < self->indexed) {
+        _reset(self);
+    }
+    while (self->indexed < *self->count) {
+        int id = self->indexed++;
+        const char* name = self->names + (size_t) id * self->stride;
+        uint32_t hash = _hash(name);
+        // keep the first of any duplicates, like the old linear search
+        if (self->slotCount) {
+            int mask = self->slotCount - 1;
+            bool duplicate = false;
+            for (int slot = hash & mask; self->slots[slot] != -1;
+                    slot = (slot + 1) & mask) {
+                if (self->hashes[slot] == hash && strcmp(name,
+                        self->names + (size_t) self->slots[slot] * self->stride) == 0) {
+                    duplicate = true;
+                    break;
+                }
+            }
+            if (duplicate) continue;
+        }
+        if ((self->used + 1) * 2 > self->slotCount) _grow(self);
+        _insert(self, id, hash);
+    }
+}
@@ -49,6 +49,8 @@ int NavGrid_findPath(int fromX, int fromY, int toX, int toY,
     ) {
         return 0;
     }
+    PROFILE_BEGIN(findPath);
+    PROFILE_COUNT(pathSearches, 1);
 
     bool* visited = calloc(_gridWidth * _gridHeight, sizeof(Vector2i));
     Vector2i* nexts = calloc(_gridWidth * _gridHeight, sizeof(Vector2i));
@@ -107,6 +109,7 @@ int NavGrid_findPath(int fromX, int fromY, int toX, int toY,
     // abort if no path found
     if (!found) {
         free(nexts);
+        PROFILE_END(findPath);
         return -1;
     }
 
@@ -124,5 +127,6 @@ int NavGrid_findPath(int fromX, int fromY, int toX, int toY,
     }
 
     free(nexts);
+    PROFILE_END(findPath);
     return length;
 }
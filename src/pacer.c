@@ -0,0 +1,227 @@
+#include "common.h"
+
+// Frame pacing and frame time stats. Frames can be paced to
+// Config_frameRate on top of (or instead of) vsync: the pacer sleeps while
+// there's time to spare and spins through the last stretch, since
+// SDL_Delay can overshoot by a millisecond or more. Every frame's update,
+// render and present times go into a short window for the F3 overlay and
+// into whole run histograms for --frame-csv, and while a capture is running
+// into a separate set that's summed up once it's done.
+
+// ===== [[ Defines ]] =====
+
+#define PACER_SPIN_MS 2 // spin rather than sleep for the last part of a wait
+#define PACER_WINDOW 240 // recent frames for the overlay
+#define PACER_BUCKET_MS 0.1
+#define PACER_BUCKETS 1000 // histogram covers up to 100ms, longer go in the last
+#define PACER_GRAPH_HEIGHT 40 // pixels, one per millisecond
+
+// ===== [[ Local Types ]] =====
+
+typedef struct {
+    float recent[PACER_WINDOW]; // ms, ring buffer
+    int histogram[PACER_BUCKETS + 1];
+    int count;
+    double sum;
+    float worst;
+} PhaseStats;
+
+// ===== [[ Declarations ]] =====
+
+static void _addToStats(PhaseStats* stats, float ms);
+static void _endCapture(void);
+static int _compareFloats(const void* a, const void* b);
+static float _getRecentPercentile(const float* sorted, int count, float p);
+static float _getHistogramPercentile(const PhaseStats* stats, float p);
+
+// ===== [[ Static Data ]] =====
+
+static const char* _phaseNames[FramePhase_COUNT] = {
+    "update", "render", "present", "frame"
+};
+
+static PhaseStats _stats[FramePhase_COUNT];
+static uint64_t _frameStart;
+static uint64_t _targetPeriod; // counter ticks per frame, 0 if not pacing
+static float _deadlineMs; // frames longer than this missed a refresh
+static int _missedCount;
+
+static PhaseStats _capture[FramePhase_COUNT];
+static char _captureName[NAME_LENGTH];
+static int _captureFrames; // frames left to capture, 0 if not capturing
+
+// ===== [[ Implementations ]] =====
+
+void Pacer_startup(void) {
+    uint64_t frequency = SDL_GetPerformanceFrequency();
+    _targetPeriod = Config_frameRate > 0 ? frequency / Config_frameRate : 0;
+
+    // without a target, frames are due once per display refresh
+    int rate = Config_frameRate;
+    SDL_DisplayMode mode;
+    if (rate <= 0 && Main_window &&
+            SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(Main_window),
+            &mode) == 0) {
+        rate = mode.refresh_rate;
+    }
+    if (rate <= 0) rate = 60;
+    _deadlineMs = 1000.0f / rate;
+    _frameStart = SDL_GetPerformanceCounter();
+}
+
+// Wait until the next frame is due, then note how long the last one took
+void Pacer_beginFrame(void) {
+    uint64_t now = SDL_GetPerformanceCounter();
+    uint64_t next = now;
+    if (_targetPeriod) {
+        uint64_t due = _frameStart + _targetPeriod;
+        uint64_t spin = SDL_GetPerformanceFrequency() * PACER_SPIN_MS / 1000;
+        if (now + spin < due) {
+            uint64_t sleepMs = (due - now - spin) * 1000 /
+                    SDL_GetPerformanceFrequency();
+            if (sleepMs > 0) SDL_Delay((Uint32) sleepMs);
+        }
+        while ((now = SDL_GetPerformanceCounter()) < due) {}
+        // the next frame keeps to the schedule unless a whole frame behind,
+        // but this one is recorded as long as it really took
+        next = now - due < _targetPeriod ? due : now;
+    }
+
+    Pacer_addSample(FramePhase_frame, _frameStart, now);
+    _frameStart = next;
+}
+
+void Pacer_addSample(FramePhase phase, uint64_t begin, uint64_t end) {
+    float ms = (end - begin) * 1000.0 / SDL_GetPerformanceFrequency();
+    _addToStats(&_stats[phase], ms);
+    // a frame half a refresh late has missed its vblank
+    if (phase == FramePhase_frame && ms > _deadlineMs * 1.5f) _missedCount++;
+
+    if (_captureFrames) {
+        _addToStats(&_capture[phase], ms);
+        if (phase == FramePhase_frame && --_captureFrames == 0) _endCapture();
+    }
+}
+
+// Collect the next frames on their own and log a summary once they're in
+void Pacer_startCapture(const char* name, int frames) {
+    memset(_capture, 0, sizeof(_capture));
+    strncpy(_captureName, name, NAME_LENGTH - 1);
+    _captureFrames = frames > 0 ? frames : 1;
+}
+
+bool Pacer_isCapturing(void) {
+    return _captureFrames > 0;
+}
+
+// Frame time graph and recent percentiles, for the F3 overlay, with the font
+// the caller looked up once
+void Pacer_drawOverlay(BFontID font) {
+    PhaseStats* frame = &_stats[FramePhase_frame];
+    int graphX = 4;
+    int graphY = SCREEN_HEIGHT - 4 - PACER_GRAPH_HEIGHT;
+    int samples = SDL_min(frame->count, PACER_WINDOW / 2);
+
+    Draw_setColor(Color_dkgray);
+    Draw_rect(graphX, graphY, PACER_WINDOW / 2, PACER_GRAPH_HEIGHT);
+    for (int i = 0; i < samples; i++) {
+        float ms = frame->recent[(frame->count - samples + i) % PACER_WINDOW];
+        int h = SDL_min((int) ms, PACER_GRAPH_HEIGHT);
+        Draw_setColor(ms > _deadlineMs * 1.5f ? Color_red : Color_lime);
+        Draw_line(graphX + i, graphY + PACER_GRAPH_HEIGHT,
+                graphX + i, graphY + PACER_GRAPH_HEIGHT - h);
+    }
+    Draw_setColor(Color_yellow);
+    int deadlineY = graphY + PACER_GRAPH_HEIGHT - (int) _deadlineMs;
+    Draw_line(graphX, deadlineY, graphX + PACER_WINDOW / 2 - 1, deadlineY);
+    Draw_setColor(Color_white);
+
+    char text[256];
+    int length = 0;
+    for (int phase = 0; phase < FramePhase_COUNT; phase++) {
+        PhaseStats* stats = &_stats[phase];
+        float sorted[PACER_WINDOW];
+        int count = SDL_min(stats->count, PACER_WINDOW);
+        memcpy(sorted, stats->recent, sizeof(float) * count);
+        qsort(sorted, count, sizeof(float), _compareFloats);
+        length += snprintf(text + length, sizeof(text) - length,
+                "%-7s %4.1f %4.1f %4.1f\n", _phaseNames[phase],
+                _getRecentPercentile(sorted, count, 0.50f),
+                _getRecentPercentile(sorted, count, 0.95f),
+                _getRecentPercentile(sorted, count, 0.99f));
+    }
+    snprintf(text + length, sizeof(text) - length, "worst %.1f missed %d",
+            frame->worst, _missedCount);
+    BFont_drawText(font, graphX + PACER_WINDOW / 2 + 6,
+            graphY - 8, "%s", text);
+}
+
+// Whole run stats, one row per phase
+bool Pacer_writeCsv(const char* path) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        Log_error("Failed to open %s for writing", path);
+        return false;
+    }
+
+    fprintf(f, "phase,frames,mean_ms,p50_ms,p95_ms,p99_ms,worst_ms,missed\n");
+    for (int phase = 0; phase < FramePhase_COUNT; phase++) {
+        PhaseStats* stats = &_stats[phase];
+        fprintf(f, "%s,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%d\n", _phaseNames[phase],
+                stats->count, stats->count ? stats->sum / stats->count : 0.0,
+                _getHistogramPercentile(stats, 0.50f),
+                _getHistogramPercentile(stats, 0.95f),
+                _getHistogramPercentile(stats, 0.99f),
+                stats->worst, phase == FramePhase_frame ? _missedCount : 0);
+    }
+
+    bool ok = !ferror(f);
+    fclose(f);
+    if (ok) Log_info("wrote frame stats to %s", path);
+    return ok;
+}
+
+static void _addToStats(PhaseStats* stats, float ms) {
+    stats->recent[stats->count % PACER_WINDOW] = ms;
+    int bucket = (int) (ms / PACER_BUCKET_MS);
+    stats->histogram[bucket < PACER_BUCKETS ? bucket : PACER_BUCKETS]++;
+    stats->count++;
+    stats->sum += ms;
+    if (ms > stats->worst) stats->worst = ms;
+}
+
+static void _endCapture(void) {
+    Log_info("%s: %d frames", _captureName, _capture[FramePhase_frame].count);
+    for (int phase = 0; phase < FramePhase_COUNT; phase++) {
+        PhaseStats* stats = &_capture[phase];
+        if (!stats->count) continue;
+        Log_info("  %-7s mean %5.2f p50 %5.2f p95 %5.2f p99 %5.2f worst %5.2f",
+                _phaseNames[phase], stats->sum / stats->count,
+                _getHistogramPercentile(stats, 0.50f),
+                _getHistogramPercentile(stats, 0.95f),
+                _getHistogramPercentile(stats, 0.99f), stats->worst);
+    }
+}
+
+static int _compareFloats(const void* a, const void* b) {
+    float fa = *(const float*) a;
+    float fb = *(const float*) b;
+    return (fa > fb) - (fa < fb);
+}
+
+static float _getRecentPercentile(const float* sorted, int count, float p) {
+    if (count == 0) return 0;
+    return sorted[(int) (p * (count - 1) + 0.5f)];
+}
+
+// middle of the bucket the percentile falls in
+static float _getHistogramPercentile(const PhaseStats* stats, float p) {
+    if (stats->count == 0) return 0;
+    int target = (int) (p * stats->count + 0.5f);
+    int seen = 0;
+    for (int i = 0; i < PACER_BUCKETS; i++) {
+        seen += stats->histogram[i];
+        if (seen >= target && seen > 0) return (i + 0.5f) * PACER_BUCKET_MS;
+    }
+    return stats->worst;
+}
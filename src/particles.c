@@ -1,11 +1,15 @@
 #include "common.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 // ===== [[ Defines ]] =====
 
 #define MAX_PARTICLE_SYSTEMS 64
-#define MAX_PARTICLE_INSTANCES 64
-#define MAX_PARTICLES_PER_INSTANCE 32
+#define MAX_PARTICLES 4096
 #define MAX_PARTICLE_SPRITES 8
+#define PARTICLE_BAND_SHIFT 3 // depth bands are 8px tall
+#define MAX_PARTICLE_BANDS ((REGION_HEIGHT * 16) >> PARTICLE_BAND_SHIFT)
 
 // ===== [[ Local Types ]] =====
 
@@ -22,30 +26,49 @@ typedef struct {
     float drag; // constant friction, 0-1
 } ParticleSystem;
 
-typedef struct {
-    bool valid;
-    ParticlesID system;
-    int age;
-    int particleCount;
-    int xbase, ybase, zbase;
-    float xs[MAX_PARTICLES_PER_INSTANCE];
-    float ys[MAX_PARTICLES_PER_INSTANCE];
-    float vxs[MAX_PARTICLES_PER_INSTANCE];
-    float vys[MAX_PARTICLES_PER_INSTANCE];
-} ParticleInstance;
-
 // ===== [[ Declarations ]] =====
 
-static float _randFloatBetween(float min, float max);
+static void _integrate(int begin, int end);
+static int _getBand(int i);
+static void _drawBand(int band);
 
 // ===== [[ Static Data ]] =====
 
 static ParticleSystem _particleSystems[MAX_PARTICLE_SYSTEMS];
 static int _particleSystemCount;
-static ParticleInstance _particleInstances[MAX_PARTICLE_INSTANCES];
+static NameIndex _particleSystemIndex = NAME_INDEX(_particleSystems, _particleSystemCount);
+
+// Global particle pool, stored as struct of arrays. Live particles are
+// kept packed at the front, so the free list is just the tail.
+static int _particleCount;
+static _Alignas(16) float _xs[MAX_PARTICLES];
+static _Alignas(16) float _ys[MAX_PARTICLES];
+static _Alignas(16) float _vxs[MAX_PARTICLES];
+static _Alignas(16) float _vys[MAX_PARTICLES];
+static _Alignas(16) float _accXs[MAX_PARTICLES];
+static _Alignas(16) float _accYs[MAX_PARTICLES];
+static _Alignas(16) float _dragFactors[MAX_PARTICLES];
+static short _systems[MAX_PARTICLES];
+static short _ages[MAX_PARTICLES];
+static uint8_t _spriteIndices[MAX_PARTICLES];
+static int _xbases[MAX_PARTICLES];
+static int _ybases[MAX_PARTICLES];
+static int _zbases[MAX_PARTICLES];
+
+// particle indices grouped by depth band, rebuilt each draw
+static short _bandStarts[MAX_PARTICLE_BANDS + 1];
+static short _bandOrder[MAX_PARTICLES];
+
+// scratch space for bulk random rolls on spawn
+static float _rolls[MAX_PARTICLES * 4];
 
 // ===== [[ Implementations ]] =====
 
+void Particles_registerTables(void) {
+    GameDb_addTable("particles", _particleSystems, sizeof(ParticleSystem),
+            &_particleSystemCount, MAX_PARTICLE_SYSTEMS, NULL);
+}
+
 void Particles_load(void) {
     Ini_readAsset("particles.ini");
 
@@ -58,13 +81,14 @@ void Particles_load(void) {
             return;
         }
 
-        ParticleSystem* particles = &_particleSystems[_particleSystemCount++];
+        ParticleSystem* particles =
+                &_particleSystems[NameIndex_add(&_particleSystemIndex, name)];
         strncpy(particles->name, name, NAME_LENGTH);
 
         particles->spriteCount = String_parseIntArrayExt(
             Ini_get(name, "sprites"), particles->sprites,
             MAX_PARTICLE_SPRITES, Sprite_find);
-        
+
         particles->animated = String_parseBool(Ini_get(name, "animated"), false);
         particles->duration = String_parseInt(Ini_get(name, "duration"), 60);
         particles->amount = String_parseInt(Ini_get(name, "amount"), 10);
@@ -83,101 +107,150 @@ void Particles_load(void) {
 
 ParticlesID Particles_find(const char* name) {
     if (!name) return -1;
-    for (int i = 0; i < _particleSystemCount; i++) {
-        if (strcmp(_particleSystems[i].name, name) == 0) return i;
-    }
+    int id = NameIndex_find(&_particleSystemIndex, name);
+    if (id != -1) return id;
     Log_warn("Cannot find particle system %s", name);
     return -1;
 }
 
 void Particles_spawn(ParticlesID particles, int x, int y, int z) {
     if (particles == -1) return;
-    int instId = -1;
-    for (int i = 0; i < MAX_PARTICLE_INSTANCES; i++) {
-        if (!_particleInstances[i].valid) {
-            instId = i;
-            break;
-        }
-    }
-    if (instId == -1) return;
-
-    ParticleInstance* instance = &_particleInstances[instId];
-    instance->valid = true;
-    instance->system = particles;
-    instance->age = 0;
-    instance->xbase = x / 16;
-    instance->ybase = y / 16;
-    instance->zbase = z;
-
     ParticleSystem* system = &_particleSystems[particles];
-    instance->particleCount = system->amount;
-    if (instance->particleCount > MAX_PARTICLES_PER_INSTANCE) {
-        instance->particleCount = MAX_PARTICLES_PER_INSTANCE;
+
+    int count = system->amount;
+    if (count > MAX_PARTICLES - _particleCount) {
+        count = MAX_PARTICLES - _particleCount;
     }
 
-    float halfRadius = system->spawnRadius / 2.0f;
-    for (int i = 0; i < instance->particleCount; i++) {
-        instance->xs[i] = _randFloatBetween(-halfRadius, halfRadius);
-        instance->ys[i] = _randFloatBetween(-halfRadius, halfRadius);
-        instance->vxs[i] = _randFloatBetween(system->minVelX, system->maxVelX);
-        instance->vys[i] = _randFloatBetween(system->minVelY, system->maxVelY);
+    float radius = system->spawnRadius;
+    float halfRadius = radius / 2.0f;
+    float velW = system->maxVelX - system->minVelX;
+    float velH = system->maxVelY - system->minVelY;
+    Random_fillUnit(RandomStream_particles, _rolls, count * 4);
+    for (int i = 0; i < count; i++) {
+        int p = _particleCount++;
+        float* roll = &_rolls[i * 4];
+        _systems[p] = particles;
+        _ages[p] = 0;
+        _spriteIndices[p] = system->spriteCount ? i % system->spriteCount : 0;
+        _xbases[p] = x / 16;
+        _ybases[p] = y / 16;
+        _zbases[p] = z;
+        _xs[p] = roll[0] * radius - halfRadius;
+        _ys[p] = roll[1] * radius - halfRadius;
+        _vxs[p] = system->minVelX + roll[2] * velW;
+        _vys[p] = system->minVelY + roll[3] * velH;
+        _accXs[p] = system->accX;
+        _accYs[p] = system->accY;
+        _dragFactors[p] = 1 - system->drag;
     }
 }
 
 void Particles_update(void) {
-    for (int i = 0; i < MAX_PARTICLE_INSTANCES; i++) {
-        ParticleInstance* instance = &_particleInstances[i];
-        ParticleSystem* system = &_particleSystems[instance->system];
-        if (!instance->valid) continue;
-
-        if (instance->age >= system->duration) {
-            instance->valid = false;
-            continue;
-        } else {
-            instance->age++;
-        }
+    PROFILE_BEGIN(particlesUpdate);
 
-        float dragFactor = 1 - system->drag;
-        for (int i = 0; i < instance->particleCount; i++) {
-            instance->xs[i] += instance->vxs[i];
-            instance->ys[i] += instance->vys[i];
-            instance->vxs[i] = (instance->vxs[i] + system->accX) * dragFactor;
-            instance->vys[i] = (instance->vys[i] + system->accY) * dragFactor;
+    // age particles and compact out the dead ones
+    int live = 0;
+    for (int i = 0; i < _particleCount; i++) {
+        if (_ages[i] >= _particleSystems[_systems[i]].duration) continue;
+        if (live != i) {
+            _xs[live] = _xs[i];
+            _ys[live] = _ys[i];
+            _vxs[live] = _vxs[i];
+            _vys[live] = _vys[i];
+            _accXs[live] = _accXs[i];
+            _accYs[live] = _accYs[i];
+            _dragFactors[live] = _dragFactors[i];
+            _systems[live] = _systems[i];
+            _spriteIndices[live] = _spriteIndices[i];
+            _xbases[live] = _xbases[i];
+            _ybases[live] = _ybases[i];
+            _zbases[live] = _zbases[i];
         }
+        _ages[live] = _ages[i] + 1;
+        live++;
     }
+    _particleCount = live;
+
+    _integrate(0, _particleCount);
+    PROFILE_END(particlesUpdate);
 }
 
 void Particles_draw(void) {
-    for (int i = 0; i < MAX_PARTICLE_INSTANCES; i++) {
-        ParticleInstance* instance = &_particleInstances[i];
-        ParticleSystem* system = &_particleSystems[instance->system];
-        if (!instance->valid) continue;
-        if (system->spriteCount == 0) continue;
+    PROFILE_BEGIN(particlesDraw);
 
-        for (int i = 0; i < instance->particleCount; i++) {
-            int index;
-            if (system->animated) {
-                index = (system->spriteCount * instance->age) / system->duration;
-                if (index >= system->spriteCount) index -= 1;
-            } else {
-                index = i % system->spriteCount;
-            }
-            SpriteID spr = system->sprites[index];
-            SpriteQueue_addSprite(spr,
-                instance->xbase + instance->xs[i],
-                instance->ybase,
-                instance->zbase - instance->ys[i]);
-        }
+    // counting sort particles into depth bands
+    short fill[MAX_PARTICLE_BANDS];
+    memset(_bandStarts, 0, sizeof(_bandStarts));
+    for (int i = 0; i < _particleCount; i++) {
+        _bandStarts[_getBand(i) + 1]++;
+    }
+    for (int band = 0; band < MAX_PARTICLE_BANDS; band++) {
+        _bandStarts[band + 1] += _bandStarts[band];
+    }
+    memcpy(fill, _bandStarts, sizeof(fill));
+    for (int i = 0; i < _particleCount; i++) {
+        _bandOrder[fill[_getBand(i)]++] = i;
+    }
+
+    // one sprite queue entry per non-empty band
+    for (int band = 0; band < MAX_PARTICLE_BANDS; band++) {
+        if (_bandStarts[band] == _bandStarts[band + 1]) continue;
+        SpriteQueue_addBatch(_drawBand, band, band << PARTICLE_BAND_SHIFT);
+    }
+    PROFILE_END(particlesDraw);
+}
+
+int Particles_getCount(void) {
+    return _particleCount;
+}
+
+// x += vx, y += vy, v = (v + acc) * drag, four particles at a time
+static void _integrate(int begin, int end) {
+    int i = begin;
+#ifdef __SSE2__
+    for (; i + 4 <= end; i += 4) {
+        __m128 vx = _mm_load_ps(&_vxs[i]);
+        __m128 vy = _mm_load_ps(&_vys[i]);
+        __m128 drag = _mm_load_ps(&_dragFactors[i]);
+        _mm_store_ps(&_xs[i], _mm_add_ps(_mm_load_ps(&_xs[i]), vx));
+        _mm_store_ps(&_ys[i], _mm_add_ps(_mm_load_ps(&_ys[i]), vy));
+        vx = _mm_mul_ps(_mm_add_ps(vx, _mm_load_ps(&_accXs[i])), drag);
+        vy = _mm_mul_ps(_mm_add_ps(vy, _mm_load_ps(&_accYs[i])), drag);
+        _mm_store_ps(&_vxs[i], vx);
+        _mm_store_ps(&_vys[i], vy);
+    }
+#endif
+    for (; i < end; i++) {
+        _xs[i] += _vxs[i];
+        _ys[i] += _vys[i];
+        _vxs[i] = (_vxs[i] + _accXs[i]) * _dragFactors[i];
+        _vys[i] = (_vys[i] + _accYs[i]) * _dragFactors[i];
     }
 }
 
-static float _randFloatBetween(float min, float max) {
-    // based on gamerand
-    static uint32_t state0 = 0x2e249079;
-    static uint32_t state1 = 0x2e249079 ^ 0x49616e42;
-    state0 = ( state0 << 16 ) + ( state0 >> 16 );
-    state0 += state1;
-    state1 += state0;
-    float delta = max - min;
-    return min + delta * (state0 / (float) UINT32_MAX);
+static int _getBand(int i) {
+    int band = _ybases[i] >> PARTICLE_BAND_SHIFT;
+    if (band < 0) return 0;
+    if (band >= MAX_PARTICLE_BANDS) return MAX_PARTICLE_BANDS - 1;
+    return band;
+}
+
+static void _drawBand(int band) {
+    for (int j = _bandStarts[band]; j < _bandStarts[band + 1]; j++) {
+        int i = _bandOrder[j];
+        ParticleSystem* system = &_particleSystems[_systems[i]];
+        if (system->spriteCount == 0) continue;
+
+        int index;
+        if (system->animated) {
+            index = (system->spriteCount * _ages[i]) / system->duration;
+            if (index >= system->spriteCount) index -= 1;
+        } else {
+            index = _spriteIndices[i];
+        }
+        int x = _xbases[i] + _xs[i];
+        int z = _zbases[i] - _ys[i];
+        Sprite_draw(system->sprites[index], x, _ybases[i] - z);
+    }
 }
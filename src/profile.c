@@ -0,0 +1,239 @@
+#include "common.h"
+
+// Per-system profiler for the F3 overlay. Scopes and counters are enums so
+// a PROFILE_BEGIN is an array index and a counter read, and all of it goes
+// away when built without HELMSGARD_PROFILE. Scopes also show up as trace
+// zones. Times are summed over each frame and averaged over a short period
+// so the table is readable.
+
+#ifdef HELMSGARD_PROFILE
+
+// ===== [[ Defines ]] =====
+
+#define PROFILE_PERIOD 30 // frames averaged per table update
+#define PROFILE_OVERLAY_ROWS 14
+
+// ===== [[ Local Types ]] =====
+
+typedef enum {
+    ProfileSort_time,
+    ProfileSort_calls,
+    ProfileSort_name,
+
+    ProfileSort_COUNT
+} ProfileSort;
+
+typedef struct {
+    Uint64 start;
+    Uint64 time; // this period
+    int calls;
+    float msPerFrame; // last period
+    float callsPerFrame;
+    Uint64 totalTime; // since the last Profile_reset
+    int totalCalls;
+} ScopeStats;
+
+// ===== [[ Declarations ]] =====
+
+static int _compareScopes(const void* a, const void* b);
+
+// ===== [[ Static Data ]] =====
+
+int Profile_counters[ProfileCounter_COUNT];
+
+static const char* _scopeNames[ProfileScope_COUNT] = {
+    [ProfileScope_storeLocations] = "StoreLocations",
+    [ProfileScope_updatePlayerControllers] = "UpdatePlayerControllers",
+    [ProfileScope_updateEnemyControllers] = "UpdateEnemyControllers",
+    [ProfileScope_followPaths] = "FollowPaths",
+    [ProfileScope_updateBoss] = "UpdateBoss",
+    [ProfileScope_updateIntent] = "UpdateIntent",
+    [ProfileScope_updateAttack] = "UpdateAttack",
+    [ProfileScope_updateHurt] = "UpdateHurt",
+    [ProfileScope_updateRolling] = "UpdateRolling",
+    [ProfileScope_updateAlert] = "UpdateAlert",
+    [ProfileScope_updateStatusEffects] = "UpdateStatusEffects",
+    [ProfileScope_updateBeingCollected] = "UpdateBeingCollected",
+    [ProfileScope_updateShake] = "UpdateShake",
+    [ProfileScope_updateLaunch] = "UpdateLaunch",
+    [ProfileScope_updateHint] = "UpdateHint",
+    [ProfileScope_entityMotion] = "EntityMotion",
+    [ProfileScope_entityIntersections] = "EntityIntersections",
+    [ProfileScope_fieldIntersections] = "FieldIntersections",
+    [ProfileScope_renderAnimations] = "RenderAnimations",
+    [ProfileScope_renderSprites] = "RenderSprites",
+    [ProfileScope_renderMarkers] = "RenderMarkers",
+    [ProfileScope_regionRender] = "Region_render",
+    [ProfileScope_spriteQueueRender] = "SpriteQueue_render",
+    [ProfileScope_particlesUpdate] = "Particles_update",
+    [ProfileScope_particlesDraw] = "Particles_draw",
+    [ProfileScope_findPath] = "NavGrid_findPath",
+};
+
+static const char* _counterNames[ProfileCounter_COUNT] = {
+    [ProfileCounter_queryRows] = "query rows",
+    [ProfileCounter_findNearest] = "findNearest",
+    [ProfileCounter_pathSearches] = "path searches",
+    [ProfileCounter_renderCopies] = "render copies",
+    [ProfileCounter_audioVoices] = "audio voices",
+    [ProfileCounter_audioSteals] = "voice steals",
+    [ProfileCounter_audioMerges] = "voice merges",
+};
+
+static ScopeStats _scopes[ProfileScope_COUNT];
+static int _counterTotals[ProfileCounter_COUNT]; // this period
+static float _countersPerFrame[ProfileCounter_COUNT]; // last period
+static int _counterRunTotals[ProfileCounter_COUNT]; // since Profile_reset
+static int _frames;
+static int _totalFrames; // since Profile_reset
+static ProfileSort _sort;
+
+// ===== [[ Implementations ]] =====
+
+void Profile_begin(ProfileScope scope) {
+    Trace_begin(_scopeNames[scope]);
+    _scopes[scope].start = SDL_GetPerformanceCounter();
+}
+
+void Profile_end(ProfileScope scope) {
+    ScopeStats* stats = &_scopes[scope];
+    Uint64 time = SDL_GetPerformanceCounter() - stats->start;
+    stats->time += time;
+    stats->calls++;
+    stats->totalTime += time;
+    stats->totalCalls++;
+    Trace_end();
+}
+
+// Fold this frame's counters in, and publish averages every period
+void Profile_endFrame(void) {
+    for (int i = 0; i < ProfileCounter_COUNT; i++) {
+        _counterTotals[i] += Profile_counters[i];
+        _counterRunTotals[i] += Profile_counters[i];
+        Profile_counters[i] = 0;
+    }
+    _totalFrames++;
+    if (++_frames < PROFILE_PERIOD) return;
+
+    double msPerTick = 1000.0 / SDL_GetPerformanceFrequency();
+    for (int i = 0; i < ProfileScope_COUNT; i++) {
+        ScopeStats* stats = &_scopes[i];
+        stats->msPerFrame = stats->time * msPerTick / _frames;
+        stats->callsPerFrame = stats->calls / (float) _frames;
+        stats->time = 0;
+        stats->calls = 0;
+    }
+    for (int i = 0; i < ProfileCounter_COUNT; i++) {
+        _countersPerFrame[i] = _counterTotals[i] / (float) _frames;
+        _counterTotals[i] = 0;
+    }
+    _frames = 0;
+}
+
+// Start the whole run totals over, e.g. after warming up
+void Profile_reset(void) {
+    for (int i = 0; i < ProfileScope_COUNT; i++) {
+        _scopes[i].totalTime = 0;
+        _scopes[i].totalCalls = 0;
+    }
+    memset(_counterRunTotals, 0, sizeof(_counterRunTotals));
+    _totalFrames = 0;
+}
+
+// Whole run totals and per frame averages, one row per scope or counter
+bool Profile_writeCsv(const char* path) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        Log_error("Failed to open %s for writing", path);
+        return false;
+    }
+
+    int frames = _totalFrames ? _totalFrames : 1;
+    fprintf(f, "name,total_ms,ms_per_frame,calls,calls_per_frame\n");
+    for (int i = 0; i < ProfileScope_COUNT; i++) {
+        double ms = Profile_getScopeMs(i);
+        fprintf(f, "%s,%.3f,%.4f,%d,%.2f\n", _scopeNames[i], ms, ms / frames,
+                _scopes[i].totalCalls, _scopes[i].totalCalls / (double) frames);
+    }
+    for (int i = 0; i < ProfileCounter_COUNT; i++) {
+        fprintf(f, "%s,,,%d,%.2f\n", _counterNames[i], _counterRunTotals[i],
+                _counterRunTotals[i] / (double) frames);
+    }
+
+    bool ok = !ferror(f);
+    fclose(f);
+    if (ok) Log_info("wrote %d frames of profile to %s", _totalFrames, path);
+    return ok;
+}
+
+const char* Profile_getScopeName(ProfileScope scope) {
+    return _scopeNames[scope];
+}
+
+double Profile_getScopeMs(ProfileScope scope) {
+    return _scopes[scope].totalTime * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+int Profile_getScopeCalls(ProfileScope scope) {
+    return _scopes[scope].totalCalls;
+}
+
+const char* Profile_getCounterName(ProfileCounter counter) {
+    return _counterNames[counter];
+}
+
+// counted up to the last Profile_endFrame
+int Profile_getCounterTotal(ProfileCounter counter) {
+    return _counterRunTotals[counter];
+}
+
+void Profile_cycleSort(void) {
+    _sort = (_sort + 1) % ProfileSort_COUNT;
+}
+
+// Table of the busiest scopes then the counters, per frame, with the font
+// the caller looked up once
+void Profile_drawOverlay(BFontID font) {
+    int order[ProfileScope_COUNT];
+    for (int i = 0; i < ProfileScope_COUNT; i++) order[i] = i;
+    if (_sort != ProfileSort_name) {
+        qsort(order, ProfileScope_COUNT, sizeof(int), _compareScopes);
+    }
+
+    static const char* sortNames[ProfileSort_COUNT] = {"ms", "calls", "name"};
+    char names[512];
+    char values[512];
+    int namesLength = snprintf(names, sizeof(names), "by %s (F5)\n",
+            sortNames[_sort]);
+    int valuesLength = snprintf(values, sizeof(values), "ms     calls\n");
+    int rows = 0;
+    for (int i = 0; i < ProfileScope_COUNT && rows < PROFILE_OVERLAY_ROWS; i++) {
+        ScopeStats* stats = &_scopes[order[i]];
+        if (stats->callsPerFrame == 0) continue;
+        namesLength += snprintf(names + namesLength, sizeof(names) - namesLength,
+                "%s\n", _scopeNames[order[i]]);
+        valuesLength += snprintf(values + valuesLength,
+                sizeof(values) - valuesLength, "%.3f  %.1f\n",
+                stats->msPerFrame, stats->callsPerFrame);
+        rows++;
+    }
+    for (int i = 0; i < ProfileCounter_COUNT; i++) {
+        namesLength += snprintf(names + namesLength, sizeof(names) - namesLength,
+                "%s\n", _counterNames[i]);
+        valuesLength += snprintf(values + valuesLength,
+                sizeof(values) - valuesLength, "%.0f\n", _countersPerFrame[i]);
+    }
+
+    BFont_drawText(font, 4, 4, "%s", names);
+    BFont_drawText(font, 110, 4, "%s", values);
+}
+
+static int _compareScopes(const void* a, const void* b) {
+    const ScopeStats* sa = &_scopes[*(const int*) a];
+    const ScopeStats* sb = &_scopes[*(const int*) b];
+    float ka = _sort == ProfileSort_time ? sa->msPerFrame : sa->callsPerFrame;
+    float kb = _sort == ProfileSort_time ? sb->msPerFrame : sb->callsPerFrame;
+    return (ka < kb) - (ka > kb);
+}
+
+#endif
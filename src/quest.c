@@ -49,12 +49,21 @@ static int _findObjective(const char* name);
 static Quest _quests[MAX_QUESTS];
 static QuestObj _questObjs[MAX_QUEST_OBJS];
 static int _questCount;
+static NameIndex _questIndex = NAME_INDEX(_quests, _questCount);
 static int _questObjCount;
+static NameIndex _questObjIndex = NAME_INDEX(_questObjs, _questObjCount);
 static int _lastPriority;
 static bool _slimeKingDefeated;
 
 // ===== [[ Implementations ]] =====
 
+void Quest_registerTables(void) {
+    GameDb_addTable("quests", _quests, sizeof(Quest),
+            &_questCount, MAX_QUESTS, NULL);
+    GameDb_addTable("questObjectives", _questObjs, sizeof(QuestObj),
+            &_questObjCount, MAX_QUEST_OBJS, NULL);
+}
+
 void Quest_load(void) {
     Ini_readAsset("quest_objs.ini");
 
@@ -128,9 +137,8 @@ void Quest_reset(void) {
 
 QuestID Quest_find(const char* name) {
     if (!name) return -1;
-    for (int i = 0; i < _questCount; i++) {
-        if (strcmp(_quests[i].name, name) == 0) return i;
-    }
+    int id = NameIndex_find(&_questIndex, name);
+    if (id != -1) return id;
     Log_warn("Cannot find quest %s", name);
     return -1;
 }
@@ -299,9 +307,8 @@ void Quest_bump(QuestID quest) {
 
 static int _findObjective(const char* name) {
     if (!name) return -1;
-    for (int i = 0; i < _questObjCount; i++) {
-        if (strcmp(_questObjs[i].name, name) == 0) return i;
-    }
+    int id = NameIndex_find(&_questObjIndex, name);
+    if (id != -1) return id;
     Log_warn("Cannot find objective %s", name);
     return -1;
 }
@@ -0,0 +1,96 @@
+#include "common.h"
+
+// xoshiro128** with one independent stream per subsystem, so that e.g.
+// extra particles don't change the outcome of combat rolls
+
+// ===== [[ Defines ]] =====
+
+#define DEFAULT_SEED 0x48656c6d73676172ull
+
+// ===== [[ Local Types ]] =====
+
+typedef struct {
+    uint32_t s[4];
+} RandomState;
+
+// ===== [[ Static Data ]] =====
+
+static RandomState _streams[RandomStream_COUNT];
+static uint64_t _seed;
+static bool _seeded;
+
+// ===== [[ Implementations ]] =====
+
+static uint64_t _splitmix64(uint64_t* x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static inline uint32_t _rotl(uint32_t x, int k) {
+    return (x << k) | (x >> (32 - k));
+}
+
+static inline uint32_t _next(RandomState* state) {
+    uint32_t* s = state->s;
+    uint32_t result = _rotl(s[1] * 5, 7) * 9;
+    uint32_t t = s[1] << 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = _rotl(s[3], 11);
+    return result;
+}
+
+static RandomState* _getStream(RandomStream stream) {
+    if (!_seeded) Random_seed(DEFAULT_SEED);
+    return &_streams[stream];
+}
+
+// Reseed every stream from a single 64 bit seed
+void Random_seed(uint64_t seed) {
+    _seed = seed;
+    _seeded = true;
+    uint64_t x = seed;
+    for (int i = 0; i < RandomStream_COUNT; i++) {
+        uint64_t a = _splitmix64(&x);
+        uint64_t b = _splitmix64(&x);
+        _streams[i].s[0] = (uint32_t) a;
+        _streams[i].s[1] = (uint32_t) (a >> 32);
+        _streams[i].s[2] = (uint32_t) b;
+        _streams[i].s[3] = (uint32_t) (b >> 32);
+    }
+}
+
+uint64_t Random_getSeed(void) {
+    if (!_seeded) Random_seed(DEFAULT_SEED);
+    return _seed;
+}
+
+uint32_t Random_next(RandomStream stream) {
+    return _next(_getStream(stream));
+}
+
+// Uniform int in [0, n)
+int Random_int(RandomStream stream, int n) {
+    if (n <= 0) return 0;
+    return (int) (((uint64_t) _next(_getStream(stream)) * (uint32_t) n) >> 32);
+}
+
+// Uniform float in [min, max)
+float Random_float(RandomStream stream, float min, float max) {
+    float unit = (_next(_getStream(stream)) >> 8) * (1.0f / 16777216.0f);
+    return min + (max - min) * unit;
+}
+
+// Fill out with count uniform floats in [0, 1)
+void Random_fillUnit(RandomStream stream, float* out, int count) {
+    RandomState state = *_getStream(stream);
+    for (int i = 0; i < count; i++) {
+        out[i] = (_next(&state) >> 8) * (1.0f / 16777216.0f);
+    }
+    _streams[stream] = state;
+}
@@ -24,9 +24,15 @@ typedef struct {
 
 static Recipe _recipes[MAX_RECIPES];
 static int _recipeCount;
+static NameIndex _recipeIndex = NAME_INDEX(_recipes, _recipeCount);
 
 // ===== [[ Implementations ]] =====
 
+void Recipe_registerTables(void) {
+    GameDb_addTable("recipes", _recipes, sizeof(Recipe),
+            &_recipeCount, MAX_RECIPES, NULL);
+}
+
 void Recipe_load(void) {
     Ini_readAsset("recipes.ini");
 
@@ -39,7 +45,7 @@ void Recipe_load(void) {
             return;
         }
 
-        Recipe* recipe = &_recipes[_recipeCount++];
+        Recipe* recipe = &_recipes[NameIndex_add(&_recipeIndex, name)];
         strncpy(recipe->name, name, NAME_LENGTH);
 
         recipe->output = Item_find(Ini_get(name, "output"));
@@ -63,9 +69,8 @@ void Recipe_load(void) {
 
 RecipeID Recipe_find(const char* name) {
     if (!name) return -1;
-    for (int i = 0; i < _recipeCount; i++) {
-        if (strcmp(_recipes[i].name, name) == 0) return i;
-    }
+    int id = NameIndex_find(&_recipeIndex, name);
+    if (id != -1) return id;
     Log_warn("Cannot find recipe %s", name);
     return -1;
 }
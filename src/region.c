@@ -51,6 +51,7 @@ Region _region;
 // ===== [[ Implementations ]] =====
 
 void Region_load(int id) {
+    Trace_begin("Region_load");
     // read region ini
     char inipath[256];
     snprintf(inipath, 256, "regions/region%02d.ini", id);
@@ -65,6 +66,7 @@ void Region_load(int id) {
     cute_tiled_map_t* map = cute_tiled_load_map_from_file(filepath, NULL);
     if (map == NULL) {
         printf("failed to load region %d\n", id);
+        Trace_end();
         return;
     }
 
@@ -149,6 +151,7 @@ void Region_load(int id) {
                     //     obj->x, obj->y);
                     if (obj->gid) {
                         int prefab = Entity_findPrefab(obj->type.ptr);
+                        Entity_prefetchPrefab(prefab);
                         int eid = Entity_spawn(obj->x * 16, obj->y * 16, prefab);
                         for (int i = 0; i < obj->property_count; i++) {
                             cute_tiled_property_t* prop = &obj->properties[i];
@@ -229,6 +232,10 @@ void Region_load(int id) {
         }
     }
     NavGrid_set(REGION_WIDTH, REGION_HEIGHT, solids);
+
+    // images and sounds prefetched by the spawns above
+    Loading_finishJobs(true);
+    Trace_end();
 }
 
 void Region_render(int layerID) {
@@ -239,6 +246,7 @@ void Region_render(int layerID) {
         case 2: layer = _region.fg; break;
     }
     if (layer == NULL) return;
+    PROFILE_BEGIN(regionRender);
 
     // tileset width
     int tsw = _region.mode == 1 ? 20 : 16;
@@ -252,8 +260,10 @@ void Region_render(int layerID) {
             SDL_Rect dst = { x * 16, y * 16, 16, 16 };
             Draw_translatePoint(&dst.x, &dst.y);
             SDL_RenderCopy(Main_renderer, _texTileset, &src, &dst);
+            PROFILE_COUNT(renderCopies, 1);
         }
     }
+    PROFILE_END(regionRender);
 }
 
 bool Region_isTileSolid(int tx, int ty) {
@@ -266,6 +276,7 @@ bool Region_isTileSolid(int tx, int ty) {
 
 // build all edge loops into field
 static void _buildField(void) {
+    Trace_begin("_buildField");
     // mark all solids
     unsigned char solids[REGION_WIDTH * REGION_HEIGHT];
     for (int y = 0; y < REGION_HEIGHT; y++) {
@@ -323,6 +334,7 @@ static void _buildField(void) {
             }
         }
     }
+    Trace_end();
 }
 
 // lut for edge masks and rotating edges
@@ -0,0 +1,219 @@
+#include "common.h"
+
+// Records the input for every game tick to a file and plays it back, so a
+// session can be run again exactly, e.g. as a benchmark or to check that a
+// change didn't alter the simulation. Recordings start from a fresh game
+// with the seed stored in the header. Each tick is a byte of flags saying
+// which parts of the input changed, the changed parts, and a checksum of
+// the entity state after the tick, which playback compares against.
+
+// ===== [[ Defines ]] =====
+
+#define REPLAY_MAGIC "HGRP"
+#define REPLAY_VERSION 1
+
+#define REPLAY_BUTTONS 0x01
+#define REPLAY_AXIS_X 0x02
+#define REPLAY_AXIS_Y 0x04
+#define REPLAY_SOURCE 0x08
+
+// ===== [[ Local Types ]] =====
+
+_Static_assert(InputButton_COUNT <= 16, "buttons are recorded as 16 bits");
+
+// ===== [[ Declarations ]] =====
+
+static void _writeHeader(void);
+static void _writeInt(uint64_t value, int bytes);
+static uint64_t _readInt(int bytes);
+
+// ===== [[ Static Data ]] =====
+
+static FILE* _file;
+static char _path[256];
+static bool _recording;
+static bool _active; // in the game, where ticks are recorded
+static uint64_t _seed;
+static int _tickCount; // recorded so far, or in the file when playing
+static int _tick;
+static InputFrame _last;
+static int _mismatchCount;
+static int _firstMismatch = -1;
+
+// ===== [[ Implementations ]] =====
+
+bool Replay_startRecording(const char* path) {
+    _file = fopen(path, "wb");
+    if (!_file) {
+        Log_error("Failed to open %s for writing", path);
+        return false;
+    }
+    strncpy(_path, path, sizeof(_path) - 1);
+    _recording = true;
+    // the header is written again once the seed and length are known
+    _writeHeader();
+    atexit(Replay_shutdown);
+    return true;
+}
+
+// Returns how many ticks the recording has, or -1 if it can't be played
+int Replay_startPlayback(const char* path) {
+    _file = fopen(path, "rb");
+    if (!_file) {
+        Log_error("Failed to open %s", path);
+        return -1;
+    }
+    strncpy(_path, path, sizeof(_path) - 1);
+
+    char magic[4];
+    if (fread(magic, 1, 4, _file) != 4 || memcmp(magic, REPLAY_MAGIC, 4) != 0) {
+        Log_error("%s is not a replay", path);
+        fclose(_file);
+        _file = NULL;
+        return -1;
+    }
+    int version = (int) _readInt(4);
+    if (version != REPLAY_VERSION) {
+        Log_error("%s is replay version %d, expected %d",
+                path, version, REPLAY_VERSION);
+        fclose(_file);
+        _file = NULL;
+        return -1;
+    }
+    _seed = _readInt(8);
+    _tickCount = (int) _readInt(4);
+    atexit(Replay_shutdown);
+    Log_info("replaying %d ticks from %s", _tickCount, path);
+    return _tickCount;
+}
+
+// Entering the game, everything from here on is recorded or played back
+void Replay_begin(void) {
+    if (!_file) return;
+    if (_recording) _seed = Random_getSeed();
+    Random_seed(_seed);
+    memset(&_last, 0, sizeof(_last));
+    _active = true;
+}
+
+// Leaving the game ends the recording
+void Replay_end(void) {
+    if (!_active) return;
+    _active = false;
+    Replay_shutdown();
+}
+
+void Replay_shutdown(void) {
+    if (!_file) return;
+    _active = false;
+
+    if (_recording) {
+        fseek(_file, 0, SEEK_SET);
+        _writeHeader();
+        bool ok = !ferror(_file);
+        fclose(_file);
+        if (ok) Log_info("recorded %d ticks to %s", _tickCount, _path);
+        else Log_error("Failed to write %s", _path);
+    } else {
+        fclose(_file);
+        if (_mismatchCount) {
+            Log_error("replay diverged on %d of %d ticks, first at tick %d",
+                    _mismatchCount, _tick, _firstMismatch);
+        } else {
+            Log_info("replay matched on all %d ticks", _tick);
+        }
+    }
+    _file = NULL;
+}
+
+bool Replay_isRecording(void) {
+    return _active && _recording;
+}
+
+bool Replay_isPlaying(void) {
+    return _active && !_recording;
+}
+
+// Every tick of the recording has been played
+bool Replay_isFinished(void) {
+    return Replay_isPlaying() && _tick >= _tickCount;
+}
+
+int Replay_getMismatchCount(void) {
+    return _mismatchCount;
+}
+
+void Replay_recordInput(const InputFrame* frame) {
+    int flags = 0;
+    if (frame->buttons != _last.buttons) flags |= REPLAY_BUTTONS;
+    if (frame->axisX != _last.axisX) flags |= REPLAY_AXIS_X;
+    if (frame->axisY != _last.axisY) flags |= REPLAY_AXIS_Y;
+    if (frame->source != _last.source) flags |= REPLAY_SOURCE;
+
+    fputc(flags, _file);
+    if (flags & REPLAY_BUTTONS) _writeInt(frame->buttons, 2);
+    if (flags & REPLAY_AXIS_X) _writeInt((uint16_t) frame->axisX, 2);
+    if (flags & REPLAY_AXIS_Y) _writeInt((uint16_t) frame->axisY, 2);
+    if (flags & REPLAY_SOURCE) fputc(frame->source, _file);
+    _last = *frame;
+}
+
+// Returns false once the recording runs out, leaving the input as it was
+bool Replay_playInput(InputFrame* frame) {
+    int flags = fgetc(_file);
+    if (flags == EOF) {
+        *frame = _last;
+        return false;
+    }
+    if (flags & REPLAY_BUTTONS) _last.buttons = (uint16_t) _readInt(2);
+    if (flags & REPLAY_AXIS_X) _last.axisX = (int16_t) _readInt(2);
+    if (flags & REPLAY_AXIS_Y) _last.axisY = (int16_t) _readInt(2);
+    if (flags & REPLAY_SOURCE) _last.source = fgetc(_file);
+    *frame = _last;
+    return true;
+}
+
+// After the game has updated: record or check what the tick did
+void Replay_endTick(void) {
+    if (!_active) return;
+    uint32_t checksum = Entity_getChecksum();
+    if (_recording) {
+        _writeInt(checksum, 4);
+        _tickCount++;
+    } else {
+        uint32_t expected = (uint32_t) _readInt(4);
+        if (checksum != expected) {
+            if (_mismatchCount == 0) {
+                Log_warn("replay diverged at tick %d (%08x, expected %08x)",
+                        _tick, checksum, expected);
+                _firstMismatch = _tick;
+            }
+            _mismatchCount++;
+        }
+    }
+    _tick++;
+}
+
+static void _writeHeader(void) {
+    fwrite(REPLAY_MAGIC, 1, 4, _file);
+    _writeInt(REPLAY_VERSION, 4);
+    _writeInt(_seed, 8);
+    _writeInt(_tickCount, 4);
+}
+
+// little endian
+static void _writeInt(uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        fputc((int) (value >> (i * 8)) & 0xff, _file);
+    }
+}
+
+static uint64_t _readInt(int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        int c = fgetc(_file);
+        if (c == EOF) return value;
+        value |= (uint64_t) c << (i * 8);
+    }
+    return value;
+}
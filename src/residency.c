@@ -0,0 +1,180 @@
+#include "common.h"
+
+// Keeps sprite images and sound chunks loaded only while they're in use.
+// Nothing is loaded up front: the first draw or play of something loads
+// it, and once more than Config_assetBudget is loaded, whatever has gone
+// unused the longest is let go. Regions prefetch what they spawn, so most
+// loading happens during the region transition rather than mid fight.
+// Prefetches are decoded on the loader threads and finished on the main
+// thread, either by the next Residency_update or when first used.
+
+// ===== [[ Defines ]] =====
+
+#define MAX_RESIDENTS 64 // per kind
+#define RESIDENCY_MIN_IDLE 60 // frames kept after last use, even over budget
+
+// ===== [[ Local Types ]] =====
+
+typedef void (*ResidentDecodeFn)(int id);
+typedef size_t (*ResidentLoadFn)(int id);
+typedef bool (*ResidentUnloadFn)(int id);
+
+typedef struct {
+    const char* name;
+    ResidentDecodeFn decode; // any thread, ahead of load
+    ResidentLoadFn load; // returns bytes now loaded, 0 if it failed
+    ResidentUnloadFn unload; // returns false if it's still in use
+} ResidentType;
+
+typedef enum {
+    ResidentState_unloaded,
+    ResidentState_decoding, // prefetched, waiting for a loader job
+    ResidentState_loaded,
+    ResidentState_failed // not tried again until evicted
+} ResidentState;
+
+typedef struct {
+    ResidentState state;
+    size_t bytes;
+    Uint32 lastUsed; // frame
+} Resident;
+
+// ===== [[ Declarations ]] =====
+
+static Resident* _get(ResidentKind kind, int id);
+static void _load(ResidentKind kind, int id);
+static void _decodeJob(void* data);
+static void _finishJob(void* data);
+static bool _unload(ResidentKind kind, int id);
+
+// ===== [[ Static Data ]] =====
+
+static const ResidentType _types[ResidentKind_COUNT] = {
+    {"image", Sprite_decodeImage, Sprite_loadImage, Sprite_unloadImage},
+    {"sound", Sound_decodeChunk, Sound_loadChunk, Sound_unloadChunk},
+};
+
+static Resident _residents[ResidentKind_COUNT][MAX_RESIDENTS];
+static size_t _loadedBytes;
+static Uint32 _frame;
+
+// ===== [[ Implementations ]] =====
+
+// Mark something as used this frame, loading it if it isn't already.
+// Returns false if it couldn't be loaded.
+bool Residency_use(ResidentKind kind, int id) {
+    Resident* resident = _get(kind, id);
+    if (!resident) return false;
+    resident->lastUsed = _frame;
+    if (resident->state == ResidentState_decoding) Loading_finishJobs(true);
+    if (resident->state == ResidentState_unloaded) _load(kind, id);
+    return resident->state == ResidentState_loaded;
+}
+
+// Start loading something that's about to be used, without waiting for it
+void Residency_prefetch(ResidentKind kind, int id) {
+    Resident* resident = _get(kind, id);
+    if (!resident) return;
+    resident->lastUsed = _frame;
+    if (resident->state != ResidentState_unloaded) return;
+    resident->state = ResidentState_decoding;
+    void* data = (void*) (intptr_t) (kind * MAX_RESIDENTS + id);
+    Loading_addJob(_decodeJob, _finishJob, data);
+}
+
+// Unload now, for hot reloading. The next use loads it again.
+void Residency_evict(ResidentKind kind, int id) {
+    Resident* resident = _get(kind, id);
+    if (!resident) return;
+    if (resident->state == ResidentState_decoding) Loading_finishJobs(true);
+    if (resident->state == ResidentState_loaded) {
+        _unload(kind, id);
+    } else {
+        resident->state = ResidentState_unloaded;
+    }
+}
+
+// Forget everything of a kind without unloading it, for when the tables
+// were replaced and their old textures or chunks are already gone
+void Residency_clear(ResidentKind kind) {
+    Loading_finishJobs(true);
+    for (int i = 0; i < MAX_RESIDENTS; i++) {
+        _loadedBytes -= _residents[kind][i].bytes;
+    }
+    memset(_residents[kind], 0, sizeof(_residents[kind]));
+}
+
+// Once per frame: unload the least recently used things while over budget
+void Residency_update(void) {
+    _frame++;
+    Loading_finishJobs(false);
+    size_t budget = (size_t) Config_assetBudget * 1024 * 1024;
+    if (!budget) return;
+
+    while (_loadedBytes > budget) {
+        Resident* oldest = NULL;
+        int oldestKind = 0;
+        int oldestId = 0;
+        for (int kind = 0; kind < ResidentKind_COUNT; kind++) {
+            for (int id = 0; id < MAX_RESIDENTS; id++) {
+                Resident* resident = &_residents[kind][id];
+                if (resident->state != ResidentState_loaded) continue;
+                if (_frame - resident->lastUsed < RESIDENCY_MIN_IDLE) continue;
+                if (!oldest || resident->lastUsed < oldest->lastUsed) {
+                    oldest = resident;
+                    oldestKind = kind;
+                    oldestId = id;
+                }
+            }
+        }
+        if (!oldest) {
+            LOG_LIMITED(warn, assets, "Assets in use exceed the %d MB budget",
+                    Config_assetBudget);
+            return;
+        }
+        // a sound that's still playing gets another go later
+        if (!_unload(oldestKind, oldestId)) oldest->lastUsed = _frame;
+    }
+}
+
+int Residency_getLoadedBytes(void) {
+    return (int) _loadedBytes;
+}
+
+static Resident* _get(ResidentKind kind, int id) {
+    if (id < 0) return NULL;
+    if (id >= MAX_RESIDENTS) {
+        Log_error("Max %s residents exceeded", _types[kind].name);
+        return NULL;
+    }
+    return &_residents[kind][id];
+}
+
+static bool _unload(ResidentKind kind, int id) {
+    Resident* resident = &_residents[kind][id];
+    if (!_types[kind].unload(id)) return false;
+    _loadedBytes -= resident->bytes;
+    resident->state = ResidentState_unloaded;
+    resident->bytes = 0;
+    return true;
+}
+
+static void _load(ResidentKind kind, int id) {
+    Resident* resident = &_residents[kind][id];
+    Trace_begin(_types[kind].name);
+    size_t bytes = _types[kind].load(id);
+    Trace_end();
+    resident->state = bytes ? ResidentState_loaded : ResidentState_failed;
+    resident->bytes = bytes;
+    _loadedBytes += bytes;
+}
+
+static void _decodeJob(void* data) {
+    int key = (int) (intptr_t) data;
+    _types[key / MAX_RESIDENTS].decode(key % MAX_RESIDENTS);
+}
+
+static void _finishJob(void* data) {
+    int key = (int) (intptr_t) data;
+    _load(key / MAX_RESIDENTS, key % MAX_RESIDENTS);
+}
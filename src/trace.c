@@ -0,0 +1,156 @@
+#include "common.h"
+
+// Scoped zones for seeing where load and frame time goes. Each thread
+// writes finished zones into its own ring buffer without locking, and the
+// buffers are written out as Chrome trace_event JSON at exit, for
+// chrome://tracing or ui.perfetto.dev. Zone names must outlive the trace,
+// string literals are best.
+
+// ===== [[ Defines ]] =====
+
+#define MAX_TRACE_THREADS 16
+#define MAX_TRACE_DEPTH 32
+#define TRACE_RING_SIZE 65536 // zones kept per thread, power of two
+
+// ===== [[ Local Types ]] =====
+
+typedef struct {
+    const char* name;
+    Uint64 begin;
+    Uint64 end;
+} TraceZone;
+
+typedef struct {
+    TraceZone* zones;
+    SDL_atomic_t head; // zones written so far, only the owner adds to it
+    SDL_threadID thread;
+    const char* threadName;
+} TraceBuffer;
+
+// ===== [[ Declarations ]] =====
+
+static TraceBuffer* _getBuffer(void);
+static void _writeJson(void);
+
+// ===== [[ Static Data ]] =====
+
+static bool _enabled;
+static char _path[256];
+static Uint64 _startTime;
+static TraceBuffer _buffers[MAX_TRACE_THREADS];
+static SDL_atomic_t _bufferCount;
+
+// per thread: its buffer and the zones it has open
+static _Thread_local TraceBuffer* _buffer;
+static _Thread_local bool _noBuffer;
+static _Thread_local const char* _threadName;
+static _Thread_local TraceZone _open[MAX_TRACE_DEPTH];
+static _Thread_local int _depth;
+
+// ===== [[ Implementations ]] =====
+
+void Trace_startup(const char* path) {
+    strncpy(_path, path, sizeof(_path) - 1);
+    _startTime = SDL_GetPerformanceCounter();
+    _enabled = true;
+    Trace_setThreadName("main");
+    // menus quit with exit(), so write the trace from there too
+    atexit(Trace_shutdown);
+}
+
+void Trace_shutdown(void) {
+    if (!_enabled) return;
+    _enabled = false;
+    _writeJson();
+}
+
+void Trace_setThreadName(const char* name) {
+    _threadName = name;
+    if (_buffer) _buffer->threadName = name;
+}
+
+void Trace_begin(const char* name) {
+    if (!_enabled) return;
+    if (_depth < MAX_TRACE_DEPTH) {
+        _open[_depth].name = name;
+        _open[_depth].begin = SDL_GetPerformanceCounter();
+    }
+    _depth++;
+}
+
+void Trace_end(void) {
+    if (!_enabled || _depth == 0) return;
+    _depth--;
+    if (_depth >= MAX_TRACE_DEPTH) return;
+
+    TraceBuffer* buffer = _getBuffer();
+    if (!buffer) return;
+    int head = SDL_AtomicGet(&buffer->head);
+    TraceZone* zone = &buffer->zones[head & (TRACE_RING_SIZE - 1)];
+    *zone = _open[_depth];
+    zone->end = SDL_GetPerformanceCounter();
+    SDL_AtomicSet(&buffer->head, head + 1);
+}
+
+// the calling thread's buffer, claimed on its first zone
+static TraceBuffer* _getBuffer(void) {
+    if (_buffer || _noBuffer) return _buffer;
+
+    int index = SDL_AtomicAdd(&_bufferCount, 1);
+    if (index >= MAX_TRACE_THREADS) {
+        _noBuffer = true;
+        return NULL;
+    }
+    TraceBuffer* buffer = &_buffers[index];
+    buffer->zones = malloc(sizeof(TraceZone) * TRACE_RING_SIZE);
+    if (!buffer->zones) {
+        _noBuffer = true;
+        return NULL;
+    }
+    buffer->thread = SDL_ThreadID();
+    buffer->threadName = _threadName;
+    _buffer = buffer;
+    return buffer;
+}
+
+static void _writeJson(void) {
+    FILE* f = fopen(_path, "w");
+    if (!f) {
+        Log_error("Failed to open %s for writing", _path);
+        return;
+    }
+
+    double usPerTick = 1000000.0 / SDL_GetPerformanceFrequency();
+    int bufferCount = SDL_min(SDL_AtomicGet(&_bufferCount), MAX_TRACE_THREADS);
+    int zoneCount = 0;
+    bool first = true;
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (int i = 0; i < bufferCount; i++) {
+        TraceBuffer* buffer = &_buffers[i];
+        if (!buffer->zones) continue;
+        unsigned long tid = (unsigned long) buffer->thread;
+        if (buffer->threadName) {
+            fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                    "\"tid\":%lu,\"args\":{\"name\":\"%s\"}}",
+                    first ? "" : ",\n", tid, buffer->threadName);
+            first = false;
+        }
+
+        // only the newest zones are left once a ring has wrapped
+        int head = SDL_AtomicGet(&buffer->head);
+        int tail = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+        for (int j = tail; j < head; j++) {
+            TraceZone* zone = &buffer->zones[j & (TRACE_RING_SIZE - 1)];
+            fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,"
+                    "\"ts\":%.3f,\"dur\":%.3f}",
+                    first ? "" : ",\n", zone->name, tid,
+                    (zone->begin - _startTime) * usPerTick,
+                    (zone->end - zone->begin) * usPerTick);
+            first = false;
+        }
+        zoneCount += head - tail;
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+    Log_info("wrote %d trace zones to %s", zoneCount, _path);
+}
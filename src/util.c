@@ -171,46 +171,3 @@ void String_parseIntDirs(const char* string, int* array,
         for (int i = 0; i < 4; i++) array[i] = def;
     }
 }
-
-void Log_error(const char* format, ...) {
-    va_list args;
-    char buf[512];
-    va_start(args, format);
-    vsnprintf(buf, 512, format, args);
-    va_end(args);
-
-    fprintf(stderr, "\x1b[31merror: %s\x1b[0m\n", buf);
-}
-
-void Log_warn(const char* format, ...) {
-    if (Config_logLevel < 1) return;
-    va_list args;
-    char buf[512];
-    va_start(args, format);
-    vsnprintf(buf, 512, format, args);
-    va_end(args);
-
-    fprintf(stderr, "\x1b[33mwarn: %s\x1b[0m\n", buf);
-}
-
-void Log_info(const char* format, ...) {
-    if (Config_logLevel < 2) return;
-    va_list args;
-    char buf[512];
-    va_start(args, format);
-    vsnprintf(buf, 512, format, args);
-    va_end(args);
-
-    fprintf(stderr, "info: %s\x1b[0m\n", buf);
-}
-
-void Log_debug(const char* format, ...) {
-    if (Config_logLevel < 3) return;
-    va_list args;
-    char buf[512];
-    va_start(args, format);
-    vsnprintf(buf, 512, format, args);
-    va_end(args);
-
-    fprintf(stderr, "\x1b[32mdebug: %s\x1b[0m\n", buf);
-}
@@ -19,9 +19,15 @@ typedef struct {
 
 static Villager _villagers[MAX_VILLAGERS];
 static int _villagerCount;
+static NameIndex _villagerIndex = NAME_INDEX(_villagers, _villagerCount);
 
 // ===== [[ Implementations ]] =====
 
+void Villager_registerTables(void) {
+    GameDb_addTable("villagers", _villagers, sizeof(Villager),
+            &_villagerCount, MAX_VILLAGERS, NULL);
+}
+
 void Villager_load(void) {
     Ini_readAsset("villagers.ini");
 
@@ -34,7 +40,7 @@ void Villager_load(void) {
             return;
         }
 
-        Villager* villager = &_villagers[_villagerCount++];
+        Villager* villager = &_villagers[NameIndex_add(&_villagerIndex, name)];
         strncpy(villager->name, name, NAME_LENGTH);
         
         const char* title = Ini_get(name, "title");
@@ -51,9 +57,8 @@ void Villager_load(void) {
 
 VillagerID Villager_find(const char* name) {
     if (!name) return -1;
-    for (int i = 0; i < _villagerCount; i++) {
-        if (strcmp(_villagers[i].name, name) == 0) return i;
-    }
+    int id = NameIndex_find(&_villagerIndex, name);
+    if (id != -1) return id;
     Log_warn("Cannot find villager %s", name);
     return -1;
 }
@@ -0,0 +1,149 @@
+#include "common.h"
+
+#ifdef __linux__
+#include <dirent.h>
+#include <errno.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// Watches assets/ and its subdirectories for saved files and hands them to
+// Loading_reloadAsset. Editors save in bursts (truncate, write, rename), so
+// changes are held until the directory has been quiet for a moment.
+
+// ===== [[ Defines ]] =====
+
+#define MAX_WATCH_DIRS 16
+#define MAX_PENDING_CHANGES 32
+#define WATCH_SETTLE_MS 100
+
+// ===== [[ Local Types ]] =====
+
+typedef struct {
+    int wd;
+    char path[MAX_ASSETPATH_LENGTH]; // relative to assets/, "" for itself
+} WatchDir;
+
+// ===== [[ Declarations ]] =====
+
+static void _addDir(const char* path);
+static void _addChange(const WatchDir* dir, const char* name);
+static bool _isTempFile(const char* name);
+
+// ===== [[ Static Data ]] =====
+
+static int _fd = -1;
+static WatchDir _dirs[MAX_WATCH_DIRS];
+static int _dirCount;
+static char _pending[MAX_PENDING_CHANGES][MAX_ASSETPATH_LENGTH];
+static int _pendingCount;
+static Uint32 _lastChangeTicks;
+
+// ===== [[ Implementations ]] =====
+
+void Watch_startup(void) {
+#ifdef __linux__
+    _fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (_fd < 0) {
+        Log_warn("Hot reload unavailable: %s", strerror(errno));
+        return;
+    }
+
+    _addDir("");
+    DIR* dir = opendir("assets");
+    if (dir) {
+        struct dirent* entry;
+        while ((entry = readdir(dir))) {
+            if (entry->d_name[0] == '.') continue;
+            _addDir(entry->d_name);
+        }
+        closedir(dir);
+    }
+    Log_info("watching %d asset directories for changes", _dirCount);
+#else
+    Log_info("Hot reload is only supported on Linux");
+#endif
+}
+
+void Watch_update(void) {
+    if (_fd < 0) return;
+
+#ifdef __linux__
+    _Alignas(struct inotify_event) char buffer[4096];
+    ssize_t length;
+    while ((length = read(_fd, buffer, sizeof(buffer))) > 0) {
+        const struct inotify_event* event;
+        for (char* p = buffer; p < buffer + length;
+                p += sizeof(struct inotify_event) + event->len) {
+            event = (const struct inotify_event*) p;
+            if (!event->len || _isTempFile(event->name)) continue;
+            for (int i = 0; i < _dirCount; i++) {
+                if (_dirs[i].wd == event->wd) {
+                    _addChange(&_dirs[i], event->name);
+                    break;
+                }
+            }
+        }
+    }
+#endif
+
+    if (_pendingCount == 0) return;
+    if (SDL_GetTicks() - _lastChangeTicks < WATCH_SETTLE_MS) return;
+    for (int i = 0; i < _pendingCount; i++) {
+        Loading_reloadAsset(_pending[i]);
+    }
+    _pendingCount = 0;
+}
+
+void Watch_shutdown(void) {
+#ifdef __linux__
+    if (_fd >= 0) close(_fd);
+#endif
+    _fd = -1;
+    _dirCount = 0;
+    _pendingCount = 0;
+}
+
+static void _addDir(const char* path) {
+#ifdef __linux__
+    if (_dirCount == MAX_WATCH_DIRS) {
+        Log_warn("Max watched directories exceeded, not watching %s", path);
+        return;
+    }
+    char filepath[MAX_ASSETPATH_LENGTH * 2];
+    snprintf(filepath, sizeof(filepath), path[0] ? "assets/%s" : "assets", path);
+    // IN_ONLYDIR makes this fail quietly for plain files
+    int wd = inotify_add_watch(_fd, filepath,
+            IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR);
+    if (wd < 0) return;
+    WatchDir* dir = &_dirs[_dirCount++];
+    dir->wd = wd;
+    strncpy(dir->path, path, MAX_ASSETPATH_LENGTH - 1);
+#endif
+}
+
+static void _addChange(const WatchDir* dir, const char* name) {
+    char assetpath[MAX_ASSETPATH_LENGTH];
+    if (dir->path[0]) {
+        snprintf(assetpath, sizeof(assetpath), "%s/%s", dir->path, name);
+    } else {
+        snprintf(assetpath, sizeof(assetpath), "%s", name);
+    }
+
+    _lastChangeTicks = SDL_GetTicks();
+    for (int i = 0; i < _pendingCount; i++) {
+        if (strcmp(_pending[i], assetpath) == 0) return;
+    }
+    if (_pendingCount == MAX_PENDING_CHANGES) {
+        Log_warn("Too many asset changes at once, ignoring %s", assetpath);
+        return;
+    }
+    strcpy(_pending[_pendingCount++], assetpath);
+}
+
+// swap and backup files editors write next to the real one
+static bool _isTempFile(const char* name) {
+    size_t length = strlen(name);
+    return name[0] == '.' || name[length - 1] == '~' ||
+            (length > 4 && strcmp(name + length - 4, ".swp") == 0);
+}